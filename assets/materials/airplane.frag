@@ -11,40 +11,26 @@ uniform sampler2D texture0;
 uniform vec4 colDiffuse;
 
 // Output fragment color
-out vec4 finalColor;
+layout(location = 0) out vec4 finalColor;
+// world space normal for post processing
+layout(location = 1) out vec2 finalNormal;
 
 // NOTE: Add here your custom variables
 
-#define     MAX_LIGHTS              4
-#define     LIGHT_DIRECTIONAL       0
-#define     LIGHT_POINT             1
-
 struct MaterialProperty {
     vec3 color;
     int useSampler;
     sampler2D sampler;
 };
 
-struct Light {
-    int enabled;
-    int type;
-    vec3 position;
-    vec3 target;
-    vec4 color;
-};
-
-// Input lighting values
-uniform Light lights[MAX_LIGHTS];
-uniform vec4 ambient;
-uniform vec3 viewPos;
-
 void main()
 {
     // Texel color fetching from texture sampler
     vec4 texelColor = texture(texture0, fragTexCoord);
     vec3 lightDot = vec3(0.0);
     vec3 normal = normalize(fragNormal);
-    vec3 viewD = normalize(viewPos - fragPosition);
+    // planes are drawn one view at a time
+    vec3 viewD = normalize(viewPositions[0].xyz - fragPosition);
     vec3 specular = vec3(0.0);
 
     // NOTE: Implement here your fragment shader code
@@ -79,4 +65,6 @@ void main()
 
     // Gamma correction
     finalColor = pow(finalColor, vec4(1.0/2.2));
+
+    finalNormal = encodeNormal(normalize(fragNormal));
 }
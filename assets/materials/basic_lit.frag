@@ -4,38 +4,30 @@
 in vec3 fragPosition;
 in vec2 fragTexCoord;
 in vec3 fragNormal;
+flat in int fragView;
+#ifdef BAKED_LIGHTING
+flat in vec4 fragLight;
+#endif
 
 // Input uniform values
 uniform sampler2D texture0;
 uniform vec4 colDiffuse;
 
 // Output fragment color
-out vec4 finalColor;
-
-#define     MAX_LIGHTS              4
-#define     LIGHT_DIRECTIONAL       0
-#define     LIGHT_POINT             1
-
-struct Light {
-    int enabled;
-    int type;
-    vec3 position;
-    vec3 target;
-    vec4 color;
-};
-
-// Input lighting values
-uniform Light lights[MAX_LIGHTS];
-uniform vec4 ambient;
-uniform vec3 viewPos;
+layout(location = 0) out vec4 finalColor;
+// world space normal for post processing
+layout(location = 1) out vec2 finalNormal;
 
 void main()
 {
     // Texel color fetching from texture sampler
     vec4 texelColor = texture(texture0, fragTexCoord);
+#ifdef BAKED_LIGHTING
+    finalColor = texelColor*fragLight;
+#else
     vec3 lightDot = vec3(0.0);
     vec3 normal = normalize(fragNormal);
-    vec3 viewD = normalize(viewPos - fragPosition);
+    vec3 viewD = normalize(viewPositions[fragView].xyz - fragPosition);
     vec3 specular = vec3(0.0);
 
     for (int i = 0; i < MAX_LIGHTS; i++)
@@ -65,7 +57,10 @@ void main()
 
     finalColor = (texelColor*((colDiffuse + vec4(specular, 1.0))*vec4(lightDot, 1.0)));
     finalColor += texelColor*(ambient/10.0)*colDiffuse;
+#endif
 
     // Gamma correction
     finalColor = pow(finalColor, vec4(1.0/2.2));
+
+    finalNormal = encodeNormal(normalize(fragNormal));
 }
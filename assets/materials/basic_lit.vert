@@ -6,13 +6,24 @@ in vec2 vertexTexCoord;
 in vec3 vertexNormal;
 
 // Input uniform values
-uniform mat4 mvp;
 uniform mat4 matModel;
 
+#ifdef BAKED_LIGHTING
+// everything the lights and ambient add up to for faces pointing along +x,
+// -x, +y, -y, +z, and -z, times colDiffuse. only right for axis aligned
+// normals, which is all the terrain has
+uniform vec4 faceLights[6];
+flat out vec4 fragLight;
+#endif
+
+// keeps each view inside of its own part of the viewport
+out float gl_ClipDistance[4];
+
 // Output vertex attributes (to fragment shader)
 out vec3 fragPosition;
 out vec2 fragTexCoord;
 out vec3 fragNormal;
+flat out int fragView;
 
 // NOTE: Add here your custom variables
 
@@ -22,7 +33,22 @@ void main()
     fragPosition = vec3(matModel*vec4(vertexPosition, 1.0));
     fragTexCoord = vertexTexCoord;
     fragNormal = normalize(vertexNormal);
+#ifdef BAKED_LIGHTING
+    vec3 axes = abs(vertexNormal);
+    int axis = axes.x > 0.5 ? 0 : (axes.y > 0.5 ? 1 : 2);
+    fragLight = faceLights[axis*2 + (vertexNormal[axis] < 0.0 ? 1 : 0)];
+#endif
 
     // Calculate final vertex position
-    gl_Position = mvp*vec4(vertexPosition, 1.0);
+    int view = gl_InstanceID % viewCount;
+    fragView = view;
+    vec4 clip = viewMvps[view]*vec4(vertexPosition, 1.0);
+    // clip against the view's own edges, then move it into its part of the
+    // viewport
+    gl_ClipDistance[0] = clip.w + clip.x;
+    gl_ClipDistance[1] = clip.w - clip.x;
+    gl_ClipDistance[2] = clip.w + clip.y;
+    gl_ClipDistance[3] = clip.w - clip.y;
+    vec4 transform = viewTransforms[view];
+    gl_Position = vec4(clip.xy*transform.xy + transform.zw*clip.w, clip.zw);
 }
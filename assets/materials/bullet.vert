@@ -5,12 +5,17 @@ in vec3 vertexPosition;
 in vec2 vertexTexCoord;
 in vec3 vertexNormal;
 
-in vec3 bulletPosition;
-in vec4 bulletVelocity; // quaternion
+// bullets fly in a straight line, from xyz starting at the time in w
+in vec4 bulletOrigin;
+in vec3 bulletVelocity;
 
 // Input uniform values
 uniform mat4 matNormal;
-uniform mat4 mvp;
+// seconds, the same clock as bulletOrigin.w
+uniform float time;
+
+// keeps each view inside of its own part of the viewport
+out float gl_ClipDistance[4];
 
 // Output vertex attributes (to fragment shader)
 out vec3 fragPosition;
@@ -21,56 +26,49 @@ out vec3 fragNormal;
 
 void main()
 {
-    // TODO: test transposing rotation matrix
-    mat4 rot;
-    rot[0].xyzw = vec4(1.0f, 0.0f, 0.0f, 0.0f);
-    rot[1].xyzw = vec4(0.0f, 1.0f, 0.0f, 0.0f);
-    rot[2].xyzw = vec4(0.0f, 0.0f, 1.0f, 0.0f);
-    rot[3].xyzw = vec4(0.0f, 0.0f, 0.0f, 1.0f);
-
-    float a2 = bulletVelocity.x * bulletVelocity.x;
-    float b2 = bulletVelocity.y * bulletVelocity.y;
-    float c2 = bulletVelocity.z * bulletVelocity.z;
-    float ac = bulletVelocity.x * bulletVelocity.z;
-    float ab = bulletVelocity.x * bulletVelocity.y;
-    float bc = bulletVelocity.y * bulletVelocity.z;
-    float ad = bulletVelocity.w * bulletVelocity.x;
-    float bd = bulletVelocity.w * bulletVelocity.y;
-    float cd = bulletVelocity.w * bulletVelocity.z;
-    
-    // m0
-    rot[0].x = 1 - 2*(b2 + c2);
-    // m1
-    rot[1].x = 2*(ab + cd);
-    // m2
-    rot[2].x = 2*(ac - bd);
+    // destroyed bullets keep their place in the buffer until they would have
+    // despawned, clip them away
+    if (bulletOrigin.w < 0.0) {
+        gl_ClipDistance[0] = -1.0;
+        gl_ClipDistance[1] = -1.0;
+        gl_ClipDistance[2] = -1.0;
+        gl_ClipDistance[3] = -1.0;
+        gl_Position = vec4(0.0);
+        return;
+    }
 
-    // m4
-    rot[0].y = 2*(ab - cd);
-    // m5
-    rot[1].y = 1 - 2*(a2 + c2);
-    // m6
-    rot[2].y = 2*(bc + ad);
-    
-    rot[0].z = 2*(ac + bd);
-    rot[1].z = 2*(bc - ad);
-    rot[2].z = 1 - 2*(a2 + b2);
+    // point the bullet's length (z) the way it is flying
+    vec3 forward = normalize(bulletVelocity);
+    vec3 up = abs(forward.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3 right = normalize(cross(up, forward));
+    up = cross(forward, right);
+    mat4 rot = mat4(vec4(right, 0.0), vec4(up, 0.0), vec4(forward, 0.0),
+                    vec4(0.0, 0.0, 0.0, 1.0));
 
+    vec3 position = bulletOrigin.xyz + bulletVelocity*(time - bulletOrigin.w);
     mat4 pos;
     pos[0].xyzw = vec4(1.0f, 0.0f, 0.0f, 0.0f);
     pos[1].xyzw = vec4(0.0f, 1.0f, 0.0f, 0.0f);
     pos[2].xyzw = vec4(0.0f, 0.0f, 1.0f, 0.0f);
-    pos[3].xyzw = vec4(bulletPosition.x, bulletPosition.y, bulletPosition.z, 1.0f);
+    pos[3].xyzw = vec4(position, 1.0f);
 
     //mat4 mvpi = pos * viewMat * projMat;
-    mat4 mvpi = mvp * pos * rot;
+    int view = gl_InstanceID % viewCount;
+    mat4 mvpi = viewMvps[view] * pos * rot;
 
     // Send vertex attributes to fragment shader
-    vec4 posWithVertex = mvpi*vec4(vertexPosition, 1.0);
-    fragPosition = vec3(posWithVertex);
+    vec4 clip = mvpi*vec4(vertexPosition, 1.0);
+    fragPosition = vec3(clip);
     fragTexCoord = vertexTexCoord;
     fragNormal = normalize(vec3(matNormal*vec4(vertexNormal, 1.0)));
 
     // Calculate final vertex position
-    gl_Position = posWithVertex;
+    // clip against the view's own edges, then move it into its part of the
+    // viewport
+    gl_ClipDistance[0] = clip.w + clip.x;
+    gl_ClipDistance[1] = clip.w - clip.x;
+    gl_ClipDistance[2] = clip.w + clip.y;
+    gl_ClipDistance[3] = clip.w - clip.y;
+    vec4 transform = viewTransforms[view];
+    gl_Position = vec4(clip.xy*transform.xy + transform.zw*clip.w, clip.zw);
 }
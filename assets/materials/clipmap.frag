@@ -0,0 +1,62 @@
+#version 330
+
+// keep in sync with NUM_PLANES in constants/general.h
+#define     NUM_PLANES              2
+
+// Input vertex attributes (from vertex shader)
+in vec3 fragPosition;
+in vec3 fragNormal;
+
+// Input uniform values
+uniform vec4 colDiffuse;
+// xz rectangles already covered by something more detailed, stored as
+// (min x, min z, max x, max z). the next level in, and the voxel terrain
+uniform vec4 innerRegion;
+uniform vec4 voxelRegions[NUM_PLANES];
+
+// Output fragment color
+layout(location = 0) out vec4 finalColor;
+// world space normal for post processing
+layout(location = 1) out vec2 finalNormal;
+
+bool inside(vec4 region, vec2 point)
+{
+    return point.x > region.x && point.y > region.y &&
+        point.x < region.z && point.y < region.w;
+}
+
+void main()
+{
+    if (inside(innerRegion, fragPosition.xz))
+    {
+        discard;
+    }
+    for (int i = 0; i < NUM_PLANES; i++)
+    {
+        if (inside(voxelRegions[i], fragPosition.xz))
+        {
+            discard;
+        }
+    }
+
+    // same gray texture and lights as the voxel terrain, minus specular
+    vec4 texelColor = vec4(vec3(130.0/255.0), 1.0);
+    vec3 normal = normalize(fragNormal);
+    vec3 lightDot = vec3(0.0);
+    for (int i = 0; i < MAX_LIGHTS; i++)
+    {
+        if (lights[i].enabled == 1 && lights[i].type == LIGHT_DIRECTIONAL)
+        {
+            vec3 light = -normalize(lights[i].target - lights[i].position);
+            lightDot += lights[i].color.rgb*max(dot(normal, light), 0.0);
+        }
+    }
+
+    finalColor = texelColor*colDiffuse*vec4(lightDot, 1.0);
+    finalColor += texelColor*(ambient/10.0)*colDiffuse;
+
+    // Gamma correction
+    finalColor = pow(finalColor, vec4(1.0/2.2));
+
+    finalNormal = encodeNormal(normalize(fragNormal));
+}
@@ -0,0 +1,46 @@
+#version 330
+
+// Input vertex attributes. x and z are the sample's coordinates on the grid
+in vec3 vertexPosition;
+
+// Input uniform values
+uniform mat4 mvp;
+// heights for every level, each a size * size square stacked vertically.
+// stored toroidally, a sample lives at its world cell modulo size
+uniform sampler2D texture0;
+uniform int level;
+uniform int size;
+// world cell of the first sample on the grid, in units of spacing
+uniform ivec2 origin;
+uniform float spacing;
+
+// Output vertex attributes (to fragment shader)
+out vec3 fragPosition;
+out vec3 fragNormal;
+
+float heightAt(ivec2 local)
+{
+    // samples off the edge of the grid are stale, stay on it
+    local = clamp(local, ivec2(0), ivec2(size - 1));
+    ivec2 cell = origin + local;
+    // % is undefined for negatives in glsl
+    ivec2 texel = cell - (size * ivec2(floor(vec2(cell) / float(size))));
+    return texelFetch(texture0, ivec2(texel.x, texel.y + (level * size)), 0).r;
+}
+
+void main()
+{
+    ivec2 local = ivec2(vertexPosition.xz);
+    float height = heightAt(local);
+
+    // central differences across two cells
+    float dx = heightAt(local + ivec2(1, 0)) - heightAt(local - ivec2(1, 0));
+    float dz = heightAt(local + ivec2(0, 1)) - heightAt(local - ivec2(0, 1));
+    fragNormal = normalize(vec3(-dx, 2.0 * spacing, -dz));
+
+    vec2 world = vec2(origin + local) * spacing;
+    fragPosition = vec3(world.x, height, world.y);
+
+    // Calculate final vertex position
+    gl_Position = mvp*vec4(fragPosition, 1.0);
+}
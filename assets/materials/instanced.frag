@@ -11,7 +11,9 @@ uniform sampler2D texture0;
 uniform vec4 colDiffuse;
 
 // Output fragment color
-out vec4 finalColor;
+layout(location = 0) out vec4 finalColor;
+// world space normal for post processing
+layout(location = 1) out vec2 finalNormal;
 
 void main()
 {
@@ -19,4 +21,6 @@ void main()
     vec4 texelColor = texture(texture0, fragTexCoord);
 
     finalColor = texelColor*colDiffuse;
+
+    finalNormal = encodeNormal(normalize(fragNormal));
 }
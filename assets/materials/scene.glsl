@@ -0,0 +1,50 @@
+// Spliced in after the #version line of every shader read with
+// shader_source_read. Shaders compile out whatever they don't use.
+
+#define     MAX_LIGHTS              4
+#define     LIGHT_DIRECTIONAL       0
+#define     LIGHT_POINT             1
+
+struct Light {
+    int enabled;
+    int type;
+    vec3 position;
+    vec3 target;
+    vec4 color;
+};
+
+// Input lighting values, and cameras. shared by every material, keep in sync
+// with SceneBlock in scene_uniforms.c
+#define     MAX_VIEWS               4
+layout(std140) uniform Scene
+{
+    Light lights[MAX_LIGHTS];
+    vec4 ambient;
+    mat4 viewMvps[MAX_VIEWS];
+    // xy scale then zw offset from each view's clip space into the viewport
+    vec4 viewTransforms[MAX_VIEWS];
+    vec4 viewPositions[MAX_VIEWS];
+    // instance i of a draw belongs to view i % viewCount
+    int viewCount;
+};
+
+// pack a unit vector into two components, octahedral mapping. how the
+// material shaders write world space normals for post processing
+vec2 encodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    vec2 folded = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx))*signs;
+    return folded*0.5 + 0.5;
+}
+
+// the inverse of encodeNormal
+vec3 decodeNormal(vec2 encoded)
+{
+    vec2 e = encoded*2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
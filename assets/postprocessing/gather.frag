@@ -10,20 +10,16 @@ in vec3 fragNormal;
 uniform sampler2D texture0;
 uniform vec4 colDiffuse;
 
-//
+// same outputs as the material shaders, so that things drawn with raylib's
+// batch also show up in the normal target
 layout(location = 0) out vec4 diffuse;
-layout(location = 1) out vec4 normal;
-layout(location = 2) out vec4 depth;
+layout(location = 1) out vec2 normal;
 
 void main()
 {
     // Texel color fetching from texture sampler
     vec4 texelColor = texture(texture0, fragTexCoord);
 
-    // diffuse = texelColor*colDiffuse;
-    // diffuse = vec4(1.0, 0.0, 0.0, 1.0);
-    diffuse = vec4(fragNormal, 1.0);
-    normal = vec4(1.0, 0.0, 0.0, 1.0);
-    depth = vec4(fragPosition.z, fragPosition.z, fragPosition.z, 1.0);
+    diffuse = texelColor*colDiffuse*fragColor;
+    normal = encodeNormal(normalize(fragNormal));
 }
-
@@ -0,0 +1,91 @@
+#version 330
+
+// Every post processing effect, fused into one pass over the scene so that
+// each effect doesn't need its own full screen pass. Add new effects here
+// rather than as separate shaders.
+
+// Input vertex attributes (from vertex shader)
+in vec2 fragTexCoord;
+in vec4 fragColor;
+
+// Input uniform values
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+// octahedral encoded world space normals
+uniform sampler2D normalTexture;
+uniform sampler2D depthTexture;
+// size of one texel of the scene textures, in texture coordinates
+uniform vec2 texelSize;
+// size of one view in texture coordinates. views are laid out in a grid from
+// the bottom left, and samples never cross into another view
+uniform vec2 viewSize;
+uniform float near;
+uniform float far;
+
+// Output fragment color
+out vec4 finalColor;
+
+// how much the linear depth can change between neighbors, relative to its
+// distance, before there is an edge
+#define DEPTH_EDGE_THRESHOLD 0.08
+// neighbors whose normals are less similar than this are an edge
+#define NORMAL_EDGE_THRESHOLD 0.8
+#define EDGE_DARKEN 0.6
+
+float linearDepth(float depth)
+{
+    float ndc = depth*2.0 - 1.0;
+    return (2.0*near*far)/(far + near - ndc*(far - near));
+}
+
+// the part of the texture this fragment's view covers
+vec4 viewBounds(vec2 uv)
+{
+    vec2 cell = floor(uv/viewSize);
+    vec2 minimum = cell*viewSize + texelSize*0.5;
+    vec2 maximum = (cell + 1.0)*viewSize - texelSize*0.5;
+    return vec4(minimum, maximum);
+}
+
+// 0 to 1, how much this fragment sits on a silhouette or crease
+float edge(vec2 uv, vec4 bounds)
+{
+    float depth = texture(depthTexture, uv).r;
+    if (depth >= 1.0)
+    {
+        // sky
+        return 0.0;
+    }
+    float center = linearDepth(depth);
+    vec3 normal = decodeNormal(texture(normalTexture, uv).rg);
+
+    const vec2 offsets[4] = vec2[](vec2(1.0, 0.0), vec2(-1.0, 0.0),
+                                   vec2(0.0, 1.0), vec2(0.0, -1.0));
+    float result = 0.0;
+    for (int i = 0; i < 4; i++)
+    {
+        vec2 neighbor = clamp(uv + offsets[i]*texelSize, bounds.xy, bounds.zw);
+        float neighborDepth = linearDepth(texture(depthTexture, neighbor).r);
+        if (abs(neighborDepth - center) > center*DEPTH_EDGE_THRESHOLD)
+        {
+            result = 1.0;
+        }
+        vec3 neighborNormal = decodeNormal(texture(normalTexture, neighbor).rg);
+        if (dot(normal, neighborNormal) < NORMAL_EDGE_THRESHOLD)
+        {
+            result = max(result, 0.5);
+        }
+    }
+    return result;
+}
+
+void main()
+{
+    vec4 bounds = viewBounds(fragTexCoord);
+    vec2 uv = clamp(fragTexCoord, bounds.xy, bounds.zw);
+    vec4 color = texture(texture0, uv);
+
+    color.rgb *= 1.0 - edge(uv, bounds)*EDGE_DARKEN;
+
+    finalColor = color*colDiffuse*fragColor;
+}
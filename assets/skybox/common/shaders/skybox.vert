@@ -19,6 +19,7 @@ void main()
     mat4 rotView = mat4(mat3(matView));
     vec4 clipPos = matProjection*rotView*vec4(vertexPosition, 1.0);
 
-    // Calculate final vertex position
-    gl_Position = clipPos;
+    // Calculate final vertex position, with a depth of 1 so the sky is always
+    // on the far plane and can be drawn last
+    gl_Position = clipPos.xyww;
 }
@@ -12,23 +12,37 @@ const zcc = @import("compile_commands");
 
 const c_sources = [_][]const u8{
     "src/airplane.c",
+    "src/arena.c",
     "src/bullet.c",
     "src/camera.c",
     "src/debug.c",
+    "src/dynamic_resolution.c",
     "src/gamestate.c",
+    "src/gl_state.c",
     "src/fps_camera.c",
+    "src/frustum.c",
     "src/input.c",
     "src/physics.c",
+    "src/physics_bench.c",
     "src/main.c",
+    "src/radix_sort.c",
     "src/render_pipeline.c",
+    "src/render_queue.c",
+    "src/scene_uniforms.c",
+    "src/shader_cache.c",
+    "src/gpu_timer.c",
+    "src/shader_source.c",
     "src/skybox.c",
+    "src/staging.c",
     "src/threadutils.c",
     "src/quicksort.c",
     "src/terrain.c",
     "src/terrain_internal.c",
+    "src/terrain_clipmap.c",
     "src/terrain_voxel_data.c",
     "src/terrain_render.c",
     "src/mesher.c",
+    "src/occlusion.c",
 };
 
 const Library = struct {
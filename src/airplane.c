@@ -1,16 +1,19 @@
 #include "airplane.h"
 #include "bullet.h"
 #include "constants/general.h"
+#include "constants/screen.h"
 #include "debug.h"
 #include "gamestate.h"
+#include "gpu_timer.h"
 #include "input.h"
 #include "physics.h"
+#include "render_queue.h"
+#include "scene_uniforms.h"
+#include "shader_cache.h"
 #include "shorthand.h"
 #include "terrain.h"
 #include "threadutils.h"
 #include <raymath.h>
-#define RLIGHTS_IMPLEMENTATION
-#include "rlights.h"
 
 #define AIRPLANE_DEBUG_WIDTH 0.5
 #define AIRPLANE_DEBUG_LENGTH 2
@@ -29,6 +32,11 @@
 // radians per frame
 #define CAMERA_MOUSE_MOVE_SENSITIVITY 0.5f
 #define CAMERA_DISTANCE 5
+// spectator cameras circle the plane they follow, further out than players'
+#define SPECTATOR_CAMERA_DISTANCE 12
+#define SPECTATOR_CAMERA_HEIGHT 4
+// radians per second
+#define SPECTATOR_ORBIT_SPEED 0.3f
 
 // rendering stuff
 #define MAX_LIGHTS 4
@@ -68,8 +76,6 @@ static AABBBatchOptions airplane_data_aabb_options;
 static Vector3BatchOptions airplane_data_position_options;
 static QuaternionBatchOptions airplane_data_direction_options;
 static FloatBatchOptions airplane_data_speed_options;
-static Light lights[MAX_LIGHTS] = {0};
-static const Vector4 ambientLight = {0.0f, 0.0f, 0.0f, 1.0f};
 static Matrix airplane_default_transform;
 
 static void airplane_update_velocity(Airplane* restrict plane,
@@ -77,22 +83,17 @@ static void airplane_update_velocity(Airplane* restrict plane,
 									 const ControllerState* restrict controls);
 static inline void airplane_update_p1(float delta_time);
 static inline void airplane_update_p2(float delta_time);
+/// Move the cameras of views past the players' around the planes they follow.
+static void airplane_update_spectators(float delta_time);
 
 void airplane_init()
 {
 	metallic = LoadTexture(metallic_texture_filename);
 	normal = LoadTexture(normal_texture_filename);
-	shader = LoadShader(0, airplane_frag_shader_filename);
+	shader = shader_cache_load(0, airplane_frag_shader_filename);
 
-	shader.locs[SHADER_LOC_VECTOR_VIEW] = GetShaderLocation(shader, "viewPos");
-	// insert ambient light as uniform
-	ShaderLocationIndex ambientLoc = GetShaderLocation(shader, "ambient");
-	SetShaderValue(shader, ambientLoc, (float*)&ambientLight,
-				   SHADER_UNIFORM_VEC4);
-
-	// all lights are empty except one directional light
-	lights[0] = CreateLight(LIGHT_DIRECTIONAL, (Vector3){100.0f, 100.0f, 0},
-							Vector3Zero(), WHITE, shader);
+	// lit by the same lights as the rest of the world, from the Scene block
+	scene_uniforms_bind_shader(shader);
 
 	for (uint8_t i = 0; i < NUM_PLANES; ++i) {
 		planes[i] = (Airplane){
@@ -157,8 +158,12 @@ void airplane_init()
 	};
 
 	FullCamera* cameras = gamestate_get_cameras_mutable();
-	for (uint8_t i = 0; i < NUM_PLANES; ++i) {
-		cameras[i].camera.target = planes[i].position;
+	for (uint8_t i = 0; i < MAX_VIEWS; ++i) {
+		cameras[i].camera.target = planes[i % NUM_PLANES].position;
+	}
+	// spread the spectators out around their planes
+	for (uint8_t i = NUM_PLANES; i < MAX_VIEWS; ++i) {
+		cameras[i].angle.x = (float)(i / NUM_PLANES) * PI;
 	}
 	cameras = NULL;
 	gamestate_return_cameras_mutable();
@@ -207,11 +212,8 @@ void airplane_update(float delta_time)
 			// const Quaternion dir = QuaternionFromVector3ToVector3(
 			// 	(Vector3){1, 0, 0}, Vector3Normalize(camera_diff));
 			BulletCreateOptions bullet_options = {
-				.bullet =
-					(Bullet){
-						.direction = planes[i].direction,
-						.position = planes[i].position,
-					},
+				.position = planes[i].position,
+				.direction = planes[i].direction,
 				.source = (Source)i,
 			};
 			bullet_create(&bullet_options);
@@ -226,6 +228,7 @@ void airplane_update(float delta_time)
 	// player-specific changes
 	airplane_update_p1(delta_time);
 	airplane_update_p2(delta_time);
+	airplane_update_spectators(delta_time);
 
 	bullet_move_and_collide_with(
 		&airplane_data_aabb_options, &airplane_data_position_options,
@@ -233,7 +236,7 @@ void airplane_update(float delta_time)
 		airplane_on_collision);
 }
 
-void airplane_draw()
+void airplane_prepare()
 {
 	for (uint8_t i = 0; i < NUM_PLANES; ++i) {
 		// model rotates toward where it is moving
@@ -242,7 +245,32 @@ void airplane_draw()
 						   QuaternionToMatrix(planes[i].direction)),
 			MatrixScale(AIRPLANE_MODEL_SCALEFACTOR, AIRPLANE_MODEL_SCALEFACTOR,
 						AIRPLANE_MODEL_SCALEFACTOR));
-		DrawModel(models[i], planes[i].position, 1.0f, WHITE);
+	}
+}
+
+/// Draw one plane, given a pointer to it in planes.
+static void airplane_draw_queued(const void* data)
+{
+	const Airplane* plane = data;
+	const uint8_t index = plane - planes;
+	gpu_timer_begin(GPU_TIMER_AIRPLANES);
+	DrawModel(models[index], plane->position, 1.0f, WHITE);
+	gpu_timer_end(GPU_TIMER_AIRPLANES);
+}
+
+void airplane_draw()
+{
+	for (uint8_t i = 0; i < NUM_PLANES; ++i) {
+		render_queue_push(&(RenderCommand){
+			.pass = RENDER_PASS_OPAQUE,
+			.shader = models[i].materials[0].shader.id,
+			.texture =
+				models[i].materials[0].maps[MATERIAL_MAP_ALBEDO].texture.id,
+			.vao = models[i].meshes[0].vaoId,
+			.depth = render_queue_distance(planes[i].position),
+			.draw = airplane_draw_queued,
+			.data = &planes[i],
+		});
 	}
 }
 
@@ -292,6 +320,23 @@ static inline void airplane_update_p1(float delta_time)
 
 static inline void airplane_update_p2(float delta_time) {}
 
+static void airplane_update_spectators(float delta_time)
+{
+	FullCamera* cameras = gamestate_get_cameras_mutable();
+	for (uint8_t i = NUM_PLANES; i < MAX_VIEWS; ++i) {
+		FullCamera* camera = &cameras[i];
+		const Vector3 target = planes[i % NUM_PLANES].position;
+		camera->angle.x += SPECTATOR_ORBIT_SPEED * delta_time;
+		camera->angle.x -= ((int)(camera->angle.x / (2 * PI))) * (2 * PI);
+		const Vector3 offset = Vector3RotateByAxisAngle(
+			(Vector3){SPECTATOR_CAMERA_DISTANCE, SPECTATOR_CAMERA_HEIGHT, 0},
+			(Vector3){0, 1, 0}, camera->angle.x);
+		camera->camera.target = target;
+		camera->camera.position = Vector3Add(target, offset);
+	}
+	gamestate_return_cameras_mutable();
+}
+
 static void airplane_update_velocity(Airplane* restrict plane,
 									 const Keystate* restrict keys,
 									 const ControllerState* restrict controls)
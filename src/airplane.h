@@ -7,7 +7,10 @@ typedef uint8_t PlaneHandle;
 void airplane_init();
 /// Update all planes.
 void airplane_update(float delta_time);
-/// Draw all planes.
+/// Orient the plane models for this frame. Call once per frame, before any
+/// airplane_draw.
+void airplane_prepare();
+/// Queue all planes to be drawn, see render_queue_push.
 void airplane_draw();
 /// unload and deallocate plane resources
 void airplane_cleanup();
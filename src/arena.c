@@ -0,0 +1,56 @@
+#include "arena.h"
+#include "threadutils.h"
+#include <assert.h>
+#include <raylib.h>
+#include <stdlib.h>
+
+// alignment of every allocation, enough for any vector type we upload
+#define ARENA_ALIGNMENT 16
+
+void arena_create(Arena* arena)
+{
+	arena->buffer = NULL;
+	arena->capacity = 0;
+	arena->used = 0;
+}
+
+size_t arena_aligned_size(size_t bytes)
+{
+	return (bytes + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+void arena_reserve(Arena* arena, size_t bytes)
+{
+	// growing moves the buffer, which would invalidate live allocations
+	assert(arena->used == 0);
+	if (bytes <= arena->capacity) {
+		return;
+	}
+
+	RL_FREE(arena->buffer);
+	arena->buffer = RL_MALLOC(bytes);
+	if (arena->buffer == NULL) {
+		TraceLog(LOG_FATAL, "Failed to grow arena to %zu bytes", bytes);
+		threadutils_exit(EXIT_FAILURE);
+	}
+	arena->capacity = bytes;
+}
+
+void* arena_alloc(Arena* arena, size_t bytes)
+{
+	const size_t size = arena_aligned_size(bytes);
+	if (arena->used + size > arena->capacity) {
+		return NULL;
+	}
+	void* result = arena->buffer + arena->used;
+	arena->used += size;
+	return result;
+}
+
+void arena_reset(Arena* arena) { arena->used = 0; }
+
+void arena_destroy(Arena* arena)
+{
+	RL_FREE(arena->buffer);
+	arena_create(arena);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/// A linear allocator. Allocations are bumped off the end of one contiguous
+/// buffer and are all freed at once with arena_reset. Meant for scratch memory
+/// which only needs to live until the end of some operation (ie. mesher output
+/// which only lives until it is uploaded to the GPU).
+typedef struct
+{
+	uint8_t* buffer;
+	size_t capacity;
+	size_t used;
+} Arena;
+
+/// Initializes an arena. Does not perform memory allocations
+void arena_create(Arena* arena);
+
+/// Make sure at least `bytes` bytes can be allocated from the arena. Only
+/// valid while the arena is empty, since growing the buffer moves it. This is
+/// the only place an arena touches the heap, and it only does so when a
+/// request is larger than any before it.
+void arena_reserve(Arena* arena, size_t bytes);
+
+/// Bump-allocate some memory. Returns NULL if the arena is out of space.
+void* arena_alloc(Arena* arena, size_t bytes);
+
+/// The number of bytes arena_alloc actually consumes for a given request, with
+/// alignment taken into account. Useful for computing arena_reserve sizes.
+size_t arena_aligned_size(size_t bytes);
+
+/// Free all allocations at once. Keeps the buffer around for reuse.
+void arena_reset(Arena* arena);
+
+/// Free the arena's buffer.
+void arena_destroy(Arena* arena);
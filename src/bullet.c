@@ -1,99 +1,145 @@
 #include "bullet.h"
 #include "bullet_internal.h"
 #include "bullet_render.h"
-#include "quicksort.h"
+#include "gl_state.h"
+#include "gpu_timer.h"
+#include "render_queue.h"
+#include "scene_uniforms.h"
+#include "shader_cache.h"
+#include "shorthand.h"
+#include "staging.h"
 #include "threadutils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-// TODO: make thread safe- when create or destroy stacks are being modified,
-// don't read from bullet data. (those are the only writers to the data so
+// TODO: make thread safe- when the create stack is being flushed, don't read
+// from bullet data. (it and bullet_destroy are the only writers to the data so
 // otherwise it should be safe)
 
+// the ring relies on it, see BulletData
+static_assert((BULLET_POOL_SIZE_INITIAL & (BULLET_POOL_SIZE_INITIAL - 1)) == 0,
+			  "Bullet pool size must be a power of two");
+
 // data
-static AABBBatchOptions bullet_data_aabb_options;
-static Vector3BatchOptions bullet_data_position_options;
-static QuaternionBatchOptions bullet_data_direction_options;
-static FloatBatchOptions bullet_data_speed_options;
 static AABB universal_aabb;
-static float universal_speed;
+/// GetTime() when bullet_init was called. bullet times count from here so
+/// they keep their precision as floats
+static double bullet_epoch;
+/// bullet time physics has swept bullets up to
+static float bullet_swept_until;
 static BulletData* bullet_data;
 static BulletCreationStack creation_stack;
-static BulletDestructionStack destruction_stack;
+/// the handler passed to bullet_move_and_collide_with, see bullet_on_collision
+static CollisionHandlerReturnCode (*bullet_collision_handler)(uint16_t,
+															   uint16_t,
+															   Contact*);
+/// bullets before the span physics is sweeping, to turn its indices into
+/// handles
+static uint16_t bullet_collision_offset;
+static bool bullet_collision_cancelled;
 
 static Mesh bullet_mesh;
 static Material bullet_material;
 static Shader bullet_shader;
+/// per-instance data attached to bullet_mesh's VAO, a copy of bullet_data
+/// kept up to date by bullet_prepare
+static unsigned int bullet_instances_vbo;
+static uint32_t bullet_instances_vbo_capacity;
+/// divisor of the instance attributes, 0 until the first DrawBullets
+static uint8_t bullet_instances_divisor;
+/// bullet the instance attributes point at, see DrawBullets
+static uint32_t bullet_instances_first;
+/// sequence numbers of the bullets which changed since the last
+/// bullet_prepare, empty when bullet_instances_dirty_first >=
+/// bullet_instances_dirty_end. the instance buffer is laid out like the ring
+static uint32_t bullet_instances_dirty_first;
+static uint32_t bullet_instances_dirty_end;
+/// bullets as of the last bullet_prepare, and the time they were drawn at
+static BulletSpan bullet_draw_spans[2];
+static uint8_t bullet_draw_span_count;
+static float bullet_draw_time;
+/// number of views the queued bullet draw is instanced for
+static uint8_t bullet_draw_view_count;
+static BulletUploadStats upload_stats;
 
 #ifndef NDEBUG
 static uint8_t bullet_times_moved_on_frame = 0;
 #endif
 
 // helper
-static void bullet_flush_destroy_stack();
 static void bullet_flush_create_stack();
-static void bullet_set_batch_options_for_dynamically_allocated_memory();
+static void bullet_draw_queued(const void* data);
+/// Seconds since bullet_init.
+static float bullet_time();
+/// Where the bullet with a sequence number is in the ring's arrays.
+static uint16_t bullet_slot(uint32_t sequence);
+static uint16_t bullet_count();
+/// Split count bullets, starting with sequence number first, into the spans
+/// of slots they take up. Returns how many spans, up to two.
+static uint8_t bullet_spans(uint32_t first, uint32_t count, BulletSpan* spans);
+static TrajectoryBatch bullet_trajectories(BulletSpan span);
+/// Call bullet_collision_handler with a handle, rather than a slot.
+static CollisionHandlerReturnCode
+bullet_on_collision(uint16_t index, uint16_t other, Contact* contact);
+/// Note that the bullet with a sequence number changed and needs to be
+/// uploaded again.
+static void bullet_mark_dirty(uint32_t sequence);
+/// Send the bullets in a span to the same slots of the instance buffer.
+static void bullet_upload(BulletSpan span);
+/// Lay out count bullets, starting at slot first, for the GPU.
+static void bullet_gather(uint16_t first, uint16_t count, Bullet* restrict out);
 static void bullet_despawn_old();
 static void bullet_increase_allocation();
 
 /// initialize bullet data
 void bullet_init()
 {
-	universal_speed = 1;
+	bullet_epoch = GetTime();
+	bullet_swept_until = 0;
 	universal_aabb = (AABB){
 		.x = BULLET_PHYSICS_WIDTH,
 		.y = BULLET_PHYSICS_WIDTH,
 		.z = BULLET_PHYSICS_LENGTH,
 	};
 
-	bullet_data = RL_MALLOC(sizeof(BulletData) +
-							(sizeof(Bullet) * BULLET_POOL_SIZE_INITIAL));
+	bullet_data = RL_MALLOC(sizeof(BulletData));
 	CHECKMEM(bullet_data);
-	bullet_data->count = 0;
+	bullet_data->head = 0;
+	bullet_data->tail = 0;
 	bullet_data->capacity = BULLET_POOL_SIZE_INITIAL;
 	bullet_data->sources = RL_MALLOC(BULLET_POOL_SIZE_INITIAL * sizeof(Source));
-	bullet_data->create_times =
-		RL_MALLOC(BULLET_POOL_SIZE_INITIAL * sizeof(double));
-	CHECKMEM(bullet_data->disabled);
+	CHECKMEM(bullet_data->sources);
+	for (uint8_t field = 0; field < BULLET_FIELD_COUNT; ++field) {
+		bullet_data->fields[field] =
+			RL_MALLOC(BULLET_POOL_SIZE_INITIAL * sizeof(float));
+		CHECKMEM(bullet_data->fields[field]);
+	}
 	// set disabled to true by default for all
 	for (size_t i = 0; i < BULLET_POOL_SIZE_INITIAL; ++i) {
 #ifndef NDEBUG
 		bullet_data->sources[i] = PLAYER_NULL;
-		bullet_data->create_times[i] = INFINITY;
 #endif
 	}
 
 	creation_stack.count = 0;
-	destruction_stack.count = 0;
-
-	bullet_data_aabb_options = (AABBBatchOptions){
-		.stride = NOSTRIDE, // arbitrary large prime number
-		.first = &universal_aabb,
-		.count = 0,
-	};
-
-	bullet_data_speed_options = (FloatBatchOptions){
-		.stride = NOSTRIDE,
-		.first = &universal_speed,
-		.count = 0,
-	};
-
-	bullet_set_batch_options_for_dynamically_allocated_memory();
+	bullet_instances_dirty_first = UINT32_MAX;
+	bullet_instances_dirty_end = 0;
 
 	// debug mesh with no normal information
 	bullet_mesh = GenMeshCube(BULLET_PHYSICS_WIDTH, BULLET_PHYSICS_WIDTH,
 							  BULLET_PHYSICS_LENGTH);
-	bullet_shader = LoadShader("assets/materials/bullet.vert",
-							   "assets/materials/instanced.frag");
+	bullet_shader = shader_cache_load("assets/materials/bullet.vert",
+									  "assets/materials/instanced.frag");
 
 	// Get shader locations
-	bullet_shader.locs[SHADER_LOC_MATRIX_MVP] =
-		GetShaderLocation(bullet_shader, "mvp");
-	bullet_shader.locs[BULLET_SHADER_LOC_POSITION] =
-		GetShaderLocationAttrib(bullet_shader, "bulletPosition");
+	scene_uniforms_bind_shader(bullet_shader);
+	bullet_shader.locs[BULLET_SHADER_LOC_ORIGIN] =
+		GetShaderLocationAttrib(bullet_shader, "bulletOrigin");
 	bullet_shader.locs[BULLET_SHADER_LOC_VELOCITY] =
 		GetShaderLocationAttrib(bullet_shader, "bulletVelocity");
+	bullet_shader.locs[BULLET_SHADER_LOC_TIME] =
+		GetShaderLocation(bullet_shader, "time");
 
 	bullet_material = LoadMaterialDefault();
 	bullet_material.shader = bullet_shader;
@@ -102,33 +148,26 @@ void bullet_init()
 
 void bullet_cleanup()
 {
+	gl_state_forget_program(bullet_material.shader.id);
 	UnloadMaterial(bullet_material); // will also clean up shader
 	UnloadMesh(bullet_mesh);
+	if (bullet_instances_vbo != 0) {
+		rlUnloadVertexBuffer(bullet_instances_vbo);
+	}
+	TraceLog(LOG_INFO, "bullets: %zu bytes uploaded, %zu instance buffers created",
+			 upload_stats.bytes_uploaded, upload_stats.buffers_created);
 	RL_FREE(bullet_data->sources);
-	RL_FREE(bullet_data->create_times);
+	for (uint8_t field = 0; field < BULLET_FIELD_COUNT; ++field) {
+		RL_FREE(bullet_data->fields[field]);
+	}
 	RL_FREE(bullet_data);
 }
 
-static void bullet_set_batch_options_for_dynamically_allocated_memory()
-{
-	bullet_data_position_options = (Vector3BatchOptions){
-		.count = bullet_data->count,
-		.first = &bullet_data->items[0].position,
-		.stride = sizeof(Bullet),
-	};
-
-	bullet_data_direction_options = (QuaternionBatchOptions){
-		.count = bullet_data->count,
-		.first = &bullet_data->items[0].direction,
-		.stride = sizeof(Bullet),
-	};
-}
-
 /// "Create" a new bullet (actually just queues it to be created)
 void bullet_create(const BulletCreateOptions* options)
 {
-	assert(QuaternionEquals(QuaternionNormalize(options->bullet.direction),
-							options->bullet.direction));
+	assert(QuaternionEquals(QuaternionNormalize(options->direction),
+							options->direction));
 	if (creation_stack.count >=
 		sizeof(creation_stack.stack) / sizeof(creation_stack.stack[0])) {
 		TraceLog(LOG_WARNING,
@@ -143,22 +182,22 @@ void bullet_create(const BulletCreateOptions* options)
 
 Source bullet_get_source(BulletHandle bullet)
 {
+	assert(bullet.raw < bullet_count());
+	const uint16_t slot = bullet_slot(bullet_data->head + bullet.raw);
 	// this is the only time we read from sources
-	assert(bullet_data->sources[bullet.raw] != PLAYER_NULL);
-	return bullet_data->sources[bullet.raw];
+	assert(bullet_data->sources[slot] != PLAYER_NULL);
+	return bullet_data->sources[slot];
 }
 
 void bullet_destroy(BulletHandle bullet)
 {
-	if (destruction_stack.count >=
-		sizeof(destruction_stack.stack) / sizeof(destruction_stack.stack[0])) {
-		TraceLog(LOG_WARNING,
-				 "Attempted to create more than %d bullets in one frame.",
-				 BULLET_STACKS_MAX_SIZE);
-		return;
-	}
-	destruction_stack.stack[destruction_stack.count] = bullet;
-	++destruction_stack.count;
+	assert(bullet.raw < bullet_count());
+	const uint32_t sequence = bullet_data->head + bullet.raw;
+	// taking it out would break up the order, so just leave a hole which
+	// despawns with the rest
+	bullet_data->fields[BULLET_SPAWN_TIME][bullet_slot(sequence)] =
+		BULLET_DESTROYED_SPAWN_TIME;
+	bullet_mark_dirty(sequence);
 }
 
 void bullet_update()
@@ -167,69 +206,184 @@ void bullet_update()
 	// reset count of how many times bullet_move_and_collide_with is called
 	bullet_times_moved_on_frame = 0;
 #endif
-	// destroy bullets first to make it more likely that creation doesn't need
-	// to reallocate
-	// first flush is for bullets other modules have queued for destruction
-	// since last update
-	bullet_flush_destroy_stack();
+	// despawn first to make it more likely that creation doesn't need to
+	// reallocate
 	bullet_despawn_old();
-	// now flush the despawned bullets
-	bullet_flush_destroy_stack();
 	bullet_flush_create_stack();
+}
+
+void bullet_prepare()
+{
+	bullet_draw_time = bullet_time();
+	bullet_draw_span_count =
+		bullet_spans(bullet_data->head, bullet_count(), bullet_draw_spans);
+	if (bullet_draw_span_count == 0) {
+		return;
+	}
 
-	// options that we pass to physics in the next frame must respect any newly
-	// created bullets
-	bullet_data_position_options.count = bullet_data->count;
-	bullet_data_direction_options.count = bullet_data->count;
-	// bullet_data_speed_options.count = 1;
-	// bullet_data_aabb_options.count = 1;
-
-	// NOTE: if (bullet_data->count > 0)... but eh branchless is probably better
-	bullet_data_position_options.first = &bullet_data->items[0].position;
-	bullet_data_direction_options.first = &bullet_data->items[0].direction;
-	// bullet_data_speed_options.first = &universal_speed;
-	// bullet_data_aabb_options.first = &universal_aabb;
+	// room for every slot, so bullets can stay where they are in the ring
+	if (ReserveBulletInstances(&bullet_mesh, &bullet_material,
+							   bullet_data->capacity, &bullet_instances_vbo,
+							   &bullet_instances_vbo_capacity)) {
+		// a new buffer starts out empty
+		++upload_stats.buffers_created;
+		bullet_instances_first = 0;
+		bullet_instances_dirty_first = bullet_data->head;
+		bullet_instances_dirty_end = bullet_data->tail;
+	}
+	// bullets which despawned since they changed don't need sending
+	const uint32_t first = bullet_instances_dirty_first > bullet_data->head
+							   ? bullet_instances_dirty_first
+							   : bullet_data->head;
+	const uint32_t end = bullet_instances_dirty_end < bullet_data->tail
+							 ? bullet_instances_dirty_end
+							 : bullet_data->tail;
+	bullet_instances_dirty_first = UINT32_MAX;
+	bullet_instances_dirty_end = 0;
+	if (first >= end) {
+		// bullets move on their own, so there's nothing to send until one is
+		// fired or destroyed
+		return;
+	}
+
+	BulletSpan spans[2];
+	const uint8_t span_count = bullet_spans(first, end - first, spans);
+	for (uint8_t i = 0; i < span_count; ++i) {
+		bullet_upload(spans[i]);
+	}
 }
 
-void bullet_draw()
+void bullet_draw(const RenderView* views, uint8_t view_count)
 {
-	DrawBullets(&bullet_mesh, &bullet_material, bullet_data->items,
-				bullet_data->count);
+	UNUSED(views);
+	bullet_draw_view_count = view_count;
+	// the ring wraps around, so bullets take one or two draws
+	for (uint8_t i = 0; i < bullet_draw_span_count; ++i) {
+		// bullets are spread all over, so there's no one depth worth sorting
+		// by
+		render_queue_push(&(RenderCommand){
+			.pass = RENDER_PASS_OPAQUE,
+			.shader = bullet_material.shader.id,
+			.vao = bullet_mesh.vaoId,
+			.tracks_gl_state = true,
+			.draw = bullet_draw_queued,
+			.data = &bullet_draw_spans[i],
+		});
+	}
 }
 
-static void bullet_flush_destroy_stack()
+BulletUploadStats bullet_get_upload_stats() { return upload_stats; }
+
+static void bullet_draw_queued(const void* data)
 {
-	if (destruction_stack.count == 0) {
-		return;
+	const BulletSpan* span = data;
+	gpu_timer_begin(GPU_TIMER_BULLETS);
+	DrawBullets(&bullet_mesh, &bullet_material, bullet_draw_view_count,
+				bullet_draw_time, bullet_instances_vbo, span->first,
+				span->count, &bullet_instances_divisor,
+				&bullet_instances_first);
+	gpu_timer_end(GPU_TIMER_BULLETS);
+}
+
+static float bullet_time() { return (float)(GetTime() - bullet_epoch); }
+
+static uint16_t bullet_slot(uint32_t sequence)
+{
+	return sequence & (bullet_data->capacity - 1);
+}
+
+static uint16_t bullet_count() { return bullet_data->tail - bullet_data->head; }
+
+static uint8_t bullet_spans(uint32_t first, uint32_t count, BulletSpan* spans)
+{
+	if (count == 0) {
+		return 0;
 	}
-	// sort destroy operations by index
-	quicksort_inplace_uint16(&destruction_stack.stack[0].raw,
-							 destruction_stack.count, sizeof(BulletHandle));
-
-	// traverse backwards because quicksort sorts low to high, but we want
-	// to remove the items at the end first
-	for (int i = destruction_stack.count - 1; i >= 0; --i) {
-		const uint16_t index = destruction_stack.stack[i].raw;
-#ifndef NDEBUG
-		if (index > bullet_data->count) {
-			TraceLog(LOG_FATAL,
-					 "Queued bullet destruction handle %d out of range of "
-					 "bullet pool with count %d",
-					 index, bullet_data->count);
-			threadutils_exit(EXIT_FAILURE);
+	const uint16_t slot = bullet_slot(first);
+	const uint16_t until_end = bullet_data->capacity - slot;
+	if (count <= until_end) {
+		spans[0] = (BulletSpan){.first = slot, .count = count};
+		return 1;
+	}
+	spans[0] = (BulletSpan){.first = slot, .count = until_end};
+	spans[1] = (BulletSpan){.first = 0, .count = count - until_end};
+	return 2;
+}
+
+static TrajectoryBatch bullet_trajectories(BulletSpan span)
+{
+	float* const* fields = bullet_data->fields;
+	return (TrajectoryBatch){
+		.origin = {&fields[BULLET_ORIGIN_X][span.first],
+				   &fields[BULLET_ORIGIN_Y][span.first],
+				   &fields[BULLET_ORIGIN_Z][span.first]},
+		.velocity = {&fields[BULLET_VELOCITY_X][span.first],
+					 &fields[BULLET_VELOCITY_Y][span.first],
+					 &fields[BULLET_VELOCITY_Z][span.first]},
+		.spawn_time = &fields[BULLET_SPAWN_TIME][span.first],
+		.count = span.count,
+	};
+}
+
+static CollisionHandlerReturnCode
+bullet_on_collision(uint16_t index, uint16_t other, Contact* contact)
+{
+	const CollisionHandlerReturnCode code = bullet_collision_handler(
+		bullet_collision_offset + index, other, contact);
+	if (code == CANCEL) {
+		bullet_collision_cancelled = true;
+	}
+	return code;
+}
+
+static void bullet_upload(BulletSpan span)
+{
+	const size_t bytes = (size_t)span.count * sizeof(Bullet);
+	const StagingRange staged = staging_alloc(bytes);
+	if (staged.data != NULL) {
+		bullet_gather(span.first, span.count, staged.data);
+		UploadBulletInstances(&staged, NULL, span.first * sizeof(Bullet),
+							  bytes, bullet_instances_vbo);
+	} else {
+		// no room in the ring, send them over a bit at a time instead
+		Bullet chunk[BULLET_UPLOAD_CHUNK];
+		const uint16_t end = span.first + span.count;
+		for (uint16_t i = span.first; i < end; i += BULLET_UPLOAD_CHUNK) {
+			const uint16_t count =
+				end - i < BULLET_UPLOAD_CHUNK ? end - i : BULLET_UPLOAD_CHUNK;
+			bullet_gather(i, count, chunk);
+			UploadBulletInstances(&staged, chunk, i * sizeof(Bullet),
+								  count * sizeof(Bullet), bullet_instances_vbo);
 		}
-#endif
-		// overwrite the destroyed bullet with the bullet at the end of the
-		// bullet list
-		bullet_data->items[index] = bullet_data->items[bullet_data->count - 1];
-		bullet_data->sources[index] =
-			bullet_data->sources[bullet_data->count - 1];
-		bullet_data->create_times[index] =
-			bullet_data->create_times[bullet_data->count - 1];
-		// no longer incude the now-copied bullet
-		--bullet_data->count;
 	}
-	destruction_stack.count = 0;
+	upload_stats.bytes_uploaded += bytes;
+}
+
+static void bullet_gather(uint16_t first, uint16_t count, Bullet* restrict out)
+{
+	float* const* fields = bullet_data->fields;
+	for (uint16_t i = 0; i < count; ++i) {
+		const uint16_t index = first + i;
+		out[i] = (Bullet){
+			.origin = {fields[BULLET_ORIGIN_X][index],
+					   fields[BULLET_ORIGIN_Y][index],
+					   fields[BULLET_ORIGIN_Z][index]},
+			.spawn_time = fields[BULLET_SPAWN_TIME][index],
+			.velocity = {fields[BULLET_VELOCITY_X][index],
+						 fields[BULLET_VELOCITY_Y][index],
+						 fields[BULLET_VELOCITY_Z][index]},
+		};
+	}
+}
+
+static void bullet_mark_dirty(uint32_t sequence)
+{
+	if (sequence < bullet_instances_dirty_first) {
+		bullet_instances_dirty_first = sequence;
+	}
+	if (sequence >= bullet_instances_dirty_end) {
+		bullet_instances_dirty_end = sequence + 1;
+	}
 }
 
 static void bullet_flush_create_stack()
@@ -238,8 +392,8 @@ static void bullet_flush_create_stack()
 		return;
 	}
 
-	// find how many allocated but unused spots there are at the end
-	uint16_t available_spots = bullet_data->capacity - bullet_data->count;
+	// find how many allocated but unused spots there are in the ring
+	uint16_t available_spots = bullet_data->capacity - bullet_count();
 
 	// maybe reallocate
 	static const uint8_t max_reallocs = 1;
@@ -250,7 +404,7 @@ static void bullet_flush_create_stack()
 			// removed altogether due to the theoretical limits of how many
 			// bullets the players can shoot
 			bullet_increase_allocation();
-			available_spots = bullet_data->capacity - bullet_data->count;
+			available_spots = bullet_data->capacity - bullet_count();
 		} else {
 			break;
 		}
@@ -266,24 +420,34 @@ static void bullet_flush_create_stack()
 
 	// space should be available at this point
 	// fill newly made space with the bullets
+	const float now = bullet_time();
 	for (uint16_t i = 0; i < creation_stack.count; ++i) {
 		assert(creation_stack.count > 0);
-		assert(bullet_data->count <= bullet_data->capacity);
+		assert(bullet_count() < bullet_data->capacity);
 
-		// create a bullet at the end of the bullet data
+		// create a bullet at the tail of the ring
 		const BulletCreateOptions* create_options = &creation_stack.stack[i];
-		const uint16_t index = bullet_data->count;
+		const uint16_t index = bullet_slot(bullet_data->tail);
 		// make sure bullet has a valid normalized direction
-		assert(QuaternionEquals(
-			QuaternionNormalize(create_options->bullet.direction),
-			create_options->bullet.direction));
-		bullet_data->items[index] = create_options->bullet;
+		assert(QuaternionEquals(QuaternionNormalize(create_options->direction),
+								create_options->direction));
+		// the only time the direction is turned into a velocity
+		const Vector3 velocity = Vector3RotateByQuaternion(
+			(Vector3){BULLET_SPEED, 0, 0}, create_options->direction);
+		float* const* fields = bullet_data->fields;
+		fields[BULLET_ORIGIN_X][index] = create_options->position.x;
+		fields[BULLET_ORIGIN_Y][index] = create_options->position.y;
+		fields[BULLET_ORIGIN_Z][index] = create_options->position.z;
+		fields[BULLET_VELOCITY_X][index] = velocity.x;
+		fields[BULLET_VELOCITY_Y][index] = velocity.y;
+		fields[BULLET_VELOCITY_Z][index] = velocity.z;
+		fields[BULLET_SPAWN_TIME][index] = now;
 		bullet_data->sources[index] = create_options->source;
-		bullet_data->create_times[index] = GetTime();
-		++bullet_data->count;
+		bullet_mark_dirty(bullet_data->tail);
+		++bullet_data->tail;
 	}
 	creation_stack.count = 0;
-	assert(bullet_data->count <= bullet_data->capacity);
+	assert(bullet_count() <= bullet_data->capacity);
 }
 
 static void bullet_increase_allocation()
@@ -299,23 +463,38 @@ static void bullet_increase_allocation()
 		threadutils_exit(EXIT_FAILURE);
 	}
 
-	bullet_data = RL_REALLOC(bullet_data,
-							 sizeof(BulletData) + (sizeof(Bullet) * new_size));
+	// the slots bullets go in depend on the capacity, so everything gets
+	// copied over to where it belongs in the new arrays
+	const uint16_t old_mask = bullet_data->capacity - 1;
+	const uint16_t new_mask = new_size - 1;
+	for (uint8_t field = 0; field < BULLET_FIELD_COUNT; ++field) {
+		float* grown = RL_MALLOC(new_size * sizeof(float));
+		CHECKMEM(grown);
+		for (uint32_t i = bullet_data->head; i != bullet_data->tail; ++i) {
+			grown[i & new_mask] = bullet_data->fields[field][i & old_mask];
+		}
+		RL_FREE(bullet_data->fields[field]);
+		bullet_data->fields[field] = grown;
+	}
 
-	bullet_data->sources =
-		RL_REALLOC(bullet_data->sources, new_size * sizeof(Source));
-	bullet_data->create_times =
-		RL_REALLOC(bullet_data->create_times, new_size * sizeof(double));
+	Source* sources = RL_MALLOC(new_size * sizeof(Source));
+	CHECKMEM(sources);
 #ifndef NDEBUG
 	// set all the new memory to defaults
-	for (size_t i = bullet_data->capacity; i < new_size; ++i) {
-		bullet_data->sources[i] = PLAYER_NULL;
-		bullet_data->create_times[i] = INFINITY;
+	for (size_t i = 0; i < new_size; ++i) {
+		sources[i] = PLAYER_NULL;
 	}
 #endif
+	for (uint32_t i = bullet_data->head; i != bullet_data->tail; ++i) {
+		sources[i & new_mask] = bullet_data->sources[i & old_mask];
+	}
+	RL_FREE(bullet_data->sources);
+	bullet_data->sources = sources;
 	bullet_data->capacity = new_size;
 
-	bullet_set_batch_options_for_dynamically_allocated_memory();
+	// and so do their copies on the GPU
+	bullet_instances_dirty_first = bullet_data->head;
+	bullet_instances_dirty_end = bullet_data->tail;
 }
 
 void bullet_move_and_collide_with(
@@ -332,32 +511,50 @@ void bullet_move_and_collide_with(
 	assert((void*)other_position != (void*)other_direction);
 	assert((void*)other_aabb != (void*)other_speed);
 	assert((void*)other_aabb != (void*)other_position);
-	// TODO: maybe try swapping the bullet data to be the second batch so it's
-	// in the inner loop. has performance implications.
-	// TODO: consider using point-to-aabb collisions for bullets, may be cheaper
-	physics_batch_collide_and_move(
-		&bullet_data_aabb_options, other_aabb, &bullet_data_position_options,
-		other_position, &bullet_data_direction_options, other_direction,
-		&bullet_data_speed_options, other_speed, handler);
+	// bullets aren't moved, just swept along the part of their path flown
+	// since last time
+	const float now = bullet_time();
+	BulletSpan spans[2] = {0};
+	const uint8_t span_count =
+		bullet_spans(bullet_data->head, bullet_count(), spans);
+	bullet_collision_handler = handler;
+	bullet_collision_offset = 0;
+	bullet_collision_cancelled = false;
+	// the other bodies are moved along with the first span, even if there are
+	// no bullets at all
+	TrajectoryBatch trajectories = bullet_trajectories(spans[0]);
+	physics_batch_sweep_and_move(&universal_aabb, &trajectories,
+								 bullet_swept_until, now, other_aabb,
+								 other_position, other_direction, other_speed,
+								 bullet_on_collision);
+	if (span_count > 1 && !bullet_collision_cancelled) {
+		bullet_collision_offset = spans[0].count;
+		trajectories = bullet_trajectories(spans[1]);
+		physics_batch_sweep(&universal_aabb, &trajectories, bullet_swept_until,
+							now, other_aabb, other_position,
+							bullet_on_collision);
+	}
+	bullet_swept_until = now;
 }
 
 static void bullet_despawn_old()
 {
-	static size_t times_called;
-	++times_called;
-
-	if (times_called < CALLS_PER_DESPAWN) {
-		return;
-	}
-
-	const double current = GetTime();
-	for (size_t i = 0; i < bullet_data->count; ++i) {
-		// times initialized to INFINITY, make sure its not that
-		assert(bullet_data->create_times[i] < current);
-		if (current - bullet_data->create_times[i] >= DESPAWN_TIME_SECONDS) {
-			bullet_destroy((BulletHandle){.raw = i});
+	const float current = bullet_time();
+	const float* spawn_times = bullet_data->fields[BULLET_SPAWN_TIME];
+	// bullets are in the order they were fired, so the old ones are all at the
+	// head. destroyed ones are freed once they get there
+	while (bullet_data->head != bullet_data->tail) {
+		const uint16_t slot = bullet_slot(bullet_data->head);
+		const float spawn_time = spawn_times[slot];
+		if (spawn_time >= 0.0f) {
+			assert(spawn_time <= current);
+			if (current - spawn_time < DESPAWN_TIME_SECONDS) {
+				break;
+			}
 		}
+#ifndef NDEBUG
+		bullet_data->sources[slot] = PLAYER_NULL;
+#endif
+		++bullet_data->head;
 	}
-
-	times_called = 0;
 }
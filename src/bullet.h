@@ -1,10 +1,12 @@
 #pragma once
 #include "physics.h"
+#include "render_pipeline.h"
 #include <raylib.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /// Way of addressing a certain bullet on a particular frame. Invalid after
-/// frame ends.
+/// frame ends, when older bullets may have despawned.
 typedef struct
 {
 	uint16_t raw;
@@ -19,16 +21,23 @@ typedef enum : uint8_t
 #endif
 } Source;
 
-/// A bullet.
+/// A bullet, as it is drawn. Bullets fly in a straight line forever, so where
+/// one is at any time is worked out from where and when it was fired rather
+/// than stored.
 typedef struct
 {
-	Vector3 position;
-	Quaternion direction;
+	Vector3 origin;
+	/// seconds since bullet_init
+	float spawn_time;
+	/// units per second
+	Vector3 velocity;
 } Bullet;
 
 typedef struct
 {
-	Bullet bullet;
+	Vector3 position;
+	/// which way the bullet flies, rotating +X
+	Quaternion direction;
 	Source source;
 } BulletCreateOptions;
 
@@ -39,13 +48,27 @@ void bullet_create(const BulletCreateOptions* options);
 /// Implemented in a cache-unfriendly way (doing this will likely read from
 /// cold memory)
 Source bullet_get_source(BulletHandle bullet);
-/// Destroy a bullet (queues it for destruction)
+/// Destroy a bullet. It stops colliding and is hidden right away, and its
+/// memory is reused once it would have despawned anyway
 void bullet_destroy(BulletHandle bullet);
-/// actually create or destroy bullets queued by bullet_create or
-/// bullet_destroy. may cause allocation
+/// actually create bullets queued by bullet_create, and despawn old ones. may
+/// cause allocation
 void bullet_update();
-/// draw all bullets
-void bullet_draw();
+/// How much instance data bullet_prepare has sent to the GPU, since
+/// bullet_init. Only bullets which were created or destroyed are sent.
+typedef struct
+{
+	size_t bytes_uploaded;
+	/// times the instance buffer had to be created or grown
+	size_t buffers_created;
+} BulletUploadStats;
+
+/// upload bullets created or destroyed since the last call to the GPU. call
+/// once per frame, before any bullet_draw
+void bullet_prepare();
+/// queue all bullets as of the last bullet_prepare, for each view at once
+void bullet_draw(const RenderView* views, uint8_t view_count);
+BulletUploadStats bullet_get_upload_stats();
 /// initialize bullet data
 void bullet_init();
 /// free memory and clean up
@@ -10,36 +10,66 @@
 #define BULLET_PHYSICS_WIDTH 0.1f
 #define BULLET_PHYSICS_LENGTH 0.5f
 #define BULLET_MASS 1
+// units per second, a unit a frame at 60 fps
+#define BULLET_SPEED 60.0f
+// must be a power of two, see BulletData
 #define BULLET_POOL_SIZE_INITIAL 256
 #define BULLET_POOL_MAX_POSSIBLE_COUNT 65535
-// maximum number of bullets that can be created/destroyed until update is
-// called (ie. per frame)
+// maximum number of bullets that can be created until update is called (ie.
+// per frame)
 #define BULLET_STACKS_MAX_SIZE 32
-// hoe many update calls should happen before looping through bullets and
-// disabling
-#define CALLS_PER_DESPAWN 20
 // time in seconds before a bullet is considered old and in need of freeing
 #define DESPAWN_TIME_SECONDS 2.0f
+// spawn time given to bullets destroyed before they despawn. physics and the
+// bullet shader skip bullets with negative spawn times
+#define BULLET_DESTROYED_SPAWN_TIME -1.0f
 // vector reallocation coefficient
 #define BULLET_ALLOCATION_SCALE_FACTOR 2
+// bullets laid out for the GPU at a time, when they can't be written straight
+// into the staging ring
+#define BULLET_UPLOAD_CHUNK 256
 
+/// The arrays in BulletData, one for each float in a bullet
+typedef enum : uint8_t
+{
+	BULLET_ORIGIN_X = 0,
+	BULLET_ORIGIN_Y,
+	BULLET_ORIGIN_Z,
+	BULLET_VELOCITY_X,
+	BULLET_VELOCITY_Y,
+	BULLET_VELOCITY_Z,
+	BULLET_SPAWN_TIME,
+	BULLET_FIELD_COUNT,
+} BulletField;
+
+/// A ring of bullets, in the order they were fired. Every bullet lives for
+/// DESPAWN_TIME_SECONDS, so the oldest are always at the head and despawning
+/// just moves it forward. Destroyed bullets keep their place until then.
 typedef struct
 {
-	uint16_t count;
+	// sequence numbers of the oldest bullet and one past the newest. they only
+	// ever count up, and a bullet's slot in the arrays is its sequence number
+	// modulo capacity
+	uint32_t head;
+	uint32_t tail;
+	// a power of two
 	uint16_t capacity;
 	Source* sources; // the source of each bullet, ie PLAYER_ONE or TWO
-	double* create_times;
-	Bullet items[0];
+	// every bullet's value of each field, so physics can sweep several
+	// bullets at once
+	float* fields[BULLET_FIELD_COUNT];
 } BulletData;
 
-// stack types
+/// Slots in BulletData's arrays which don't wrap around the end of them.
 typedef struct
 {
+	uint16_t first;
 	uint16_t count;
-	BulletCreateOptions stack[BULLET_STACKS_MAX_SIZE];
-} BulletCreationStack;
+} BulletSpan;
+
+// stack types
 typedef struct
 {
 	uint16_t count;
-	BulletHandle stack[BULLET_STACKS_MAX_SIZE];
-} BulletDestructionStack;
+	BulletCreateOptions stack[BULLET_STACKS_MAX_SIZE];
+} BulletCreationStack;
@@ -1,8 +1,11 @@
 #pragma once
 #include "bullet_internal.h"
+#include "gl_state.h"
+#include "staging.h"
 #include <raylib.h>
 #include <raymath.h>
 #include <rlgl.h>
+#include <stddef.h>
 #include <stdlib.h>
 
 // updated 09/03/23. really should come from raylib's
@@ -12,262 +15,209 @@
 
 // NOTE: raylib defines shader locs up to 25. allows for a max of 32
 #define BULLET_SHADER_LOC_VELOCITY 26
-#define BULLET_SHADER_LOC_POSITION 27
+#define BULLET_SHADER_LOC_ORIGIN 27
+#define BULLET_SHADER_LOC_TIME 28
 
-// Draw multiple mesh instances with material and different transforms
-void DrawBullets(const Mesh* mesh, const Material* material,
-				 const Bullet* bullets, uint16_t instances)
-{
-	// Instancing required variables
-	unsigned int instancesVboId = 0;
+// Instance buffer size the first time one is needed. Doubles whenever it runs
+// out
+#define BULLET_INSTANCES_INITIAL 1024
 
-	// Bind shader program
-	rlEnableShader(material->shader.id);
+// Point the mesh VAO's instance attributes at the bullet `first` bullets into
+// the instance buffer. The VAO and buffer must already be bound.
+static void PointBulletAttributes(const Material* material, uint32_t first)
+{
+	const size_t offset = first * sizeof(Bullet);
+	// the origin and spawn time, read as one vec4
+	// rlSetVertexAttribute(unsigned int index, int compSize, int type, bool
+	// normalized, int stride, const void *pointer);
+	rlSetVertexAttribute(material->shader.locs[BULLET_SHADER_LOC_ORIGIN], 4,
+						 RL_FLOAT, 0, sizeof(Bullet),
+						 (void*)(offset + offsetof(Bullet, origin)));
+	rlSetVertexAttribute(material->shader.locs[BULLET_SHADER_LOC_VELOCITY], 3,
+						 RL_FLOAT, 0, sizeof(Bullet),
+						 (void*)(offset + offsetof(Bullet, velocity)));
+}
 
-	// Send required data to shader (matrices, values)
-	//-----------------------------------------------------
-	// Upload to shader material.colDiffuse
-	if (material->shader.locs[SHADER_LOC_COLOR_DIFFUSE] != -1) {
-		float values[4] = {
-			(float)material->maps[MATERIAL_MAP_DIFFUSE].color.r / 255.0f,
-			(float)material->maps[MATERIAL_MAP_DIFFUSE].color.g / 255.0f,
-			(float)material->maps[MATERIAL_MAP_DIFFUSE].color.b / 255.0f,
-			(float)material->maps[MATERIAL_MAP_DIFFUSE].color.a / 255.0f};
+// Make sure the instance buffer attached to the mesh's VAO has room for at
+// least instances bullets. If it is missing or too small, it is replaced with
+// one at least twice as big and the instance attributes are pointed at it.
+// Returns whether a new buffer was created.
+bool ReserveBulletInstances(const Mesh* mesh, const Material* material,
+							uint32_t instances, unsigned int* instancesVboId,
+							uint32_t* instancesVboCapacity)
+{
+	static_assert(sizeof(Bullet) % sizeof(float) == 0,
+				  "Bullet incorrectly sized for transmission to gpu");
+	static_assert(offsetof(Bullet, spawn_time) == sizeof(Vector3),
+				  "bulletOrigin expects the spawn time right after the origin");
 
-		rlSetUniform(material->shader.locs[SHADER_LOC_COLOR_DIFFUSE], values,
-					 SHADER_UNIFORM_VEC4, 1);
+	if (*instancesVboId != 0 && instances <= *instancesVboCapacity) {
+		return false;
 	}
 
-	// Upload to shader material.colSpecular (if location available)
-	if (material->shader.locs[SHADER_LOC_COLOR_SPECULAR] != -1) {
-		float values[4] = {
-			(float)material->maps[SHADER_LOC_COLOR_SPECULAR].color.r / 255.0f,
-			(float)material->maps[SHADER_LOC_COLOR_SPECULAR].color.g / 255.0f,
-			(float)material->maps[SHADER_LOC_COLOR_SPECULAR].color.b / 255.0f,
-			(float)material->maps[SHADER_LOC_COLOR_SPECULAR].color.a / 255.0f};
-
-		rlSetUniform(material->shader.locs[SHADER_LOC_COLOR_SPECULAR], values,
-					 SHADER_UNIFORM_VEC4, 1);
+	if (*instancesVboId != 0) {
+		rlUnloadVertexBuffer(*instancesVboId);
+	}
+	uint32_t capacity = *instancesVboCapacity > 0 ? *instancesVboCapacity * 2
+												  : BULLET_INSTANCES_INITIAL;
+	while (capacity < instances) {
+		capacity *= 2;
 	}
-
-	// Get a copy of current matrices to work with,
-	// just in case stereo render is required, and we need to modify them
-	// NOTE: At this point the modelview matrix just contains the view matrix
-	// (camera) That's because BeginMode3D() sets it and there is no
-	// model-drawing function that modifies it, all use rlPushMatrix() and
-	// rlPopMatrix()
-	Matrix matModel = MatrixIdentity();
-	Matrix matView = rlGetMatrixModelview();
-	Matrix matModelView = MatrixIdentity();
-	Matrix matProjection = rlGetMatrixProjection();
-
-	// Upload view and projection matrices (if locations available)
-	if (material->shader.locs[SHADER_LOC_MATRIX_VIEW] != -1)
-		rlSetUniformMatrix(material->shader.locs[SHADER_LOC_MATRIX_VIEW],
-						   matView);
-	if (material->shader.locs[SHADER_LOC_MATRIX_PROJECTION] != -1)
-		rlSetUniformMatrix(material->shader.locs[SHADER_LOC_MATRIX_PROJECTION],
-						   matProjection);
 
 	// Enable mesh VAO to attach new buffer
 	rlEnableVertexArray(mesh->vaoId);
 
-	// This could alternatively use a static VBO and either glMapBuffer() or
-	// glBufferSubData(). It isn't clear which would be reliably faster in all
-	// cases and on all platforms, anecdotally glMapBuffer() seems very slow
-	// (syncs) while glBufferSubData() seems no faster, since we're transferring
-	// all the transform matrices anyway
-	static_assert(sizeof(Bullet) % sizeof(float) == 0,
-				  "Bullet incorrectly sized for transmission to gpu");
-	instancesVboId =
-		rlLoadVertexBuffer(bullets, (int)(instances * sizeof(Bullet)), false);
+	*instancesVboId =
+		rlLoadVertexBuffer(NULL, (int)(capacity * sizeof(Bullet)), true);
+	*instancesVboCapacity = capacity;
 
-	rlEnableVertexAttribute(material->shader.locs[BULLET_SHADER_LOC_POSITION]);
+	rlEnableVertexAttribute(material->shader.locs[BULLET_SHADER_LOC_ORIGIN]);
 	rlEnableVertexAttribute(material->shader.locs[BULLET_SHADER_LOC_VELOCITY]);
 
-	// TODO: figure out what this means
-	rlSetVertexAttributeDivisor(
-		material->shader.locs[BULLET_SHADER_LOC_POSITION], 1);
-	rlSetVertexAttributeDivisor(
-		material->shader.locs[BULLET_SHADER_LOC_VELOCITY], 1);
+	// how often the attributes advance depends on the number of views, so
+	// their divisors are set by DrawBullets
+	PointBulletAttributes(material, 0);
 
-	// pass in the position part of the buffer
-	// rlSetVertexAttribute(unsigned int index, int compSize, int type, bool
-	// normalized, int stride, const void *pointer);
-	rlSetVertexAttribute(material->shader.locs[BULLET_SHADER_LOC_POSITION], 3,
-						 RL_FLOAT, 0, sizeof(Bullet), 0);
-
-	// and the direction (offset by one vector3)
-	rlSetVertexAttribute(material->shader.locs[BULLET_SHADER_LOC_VELOCITY], 4,
-						 RL_FLOAT, 0, sizeof(Bullet), (void*)(sizeof(Vector3)));
+	// WARNING: Disable vertex attribute color input if mesh can not provide
+	// that data (despite location being enabled in shader). this is VAO
+	// state, so once is enough
+	if (mesh->vboId[3] == 0 &&
+		material->shader.locs[SHADER_LOC_VERTEX_COLOR] != -1)
+		rlDisableVertexAttribute(
+			material->shader.locs[SHADER_LOC_VERTEX_COLOR]);
 
 	rlDisableVertexBuffer();
 	rlDisableVertexArray();
+	return true;
+}
 
-	// Accumulate internal matrix transform (push/pop) and view matrix
-	// NOTE: In this case, model instance transformation must be computed in the
-	// shader
-	matModelView = MatrixMultiply(rlGetMatrixTransform(), matView);
+// Send bytes bytes of instances to offset bytes into the instance buffer. If
+// staged has data the instances were written straight into it, and are copied
+// over on the GPU. Otherwise they are uploaded from bullets.
+void UploadBulletInstances(const StagingRange* staged, const Bullet* bullets,
+						   size_t offset, size_t bytes,
+						   unsigned int instancesVboId)
+{
+	if (staged->data != NULL) {
+		staging_copy(staged, 0, bytes, instancesVboId, offset);
+		return;
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, instancesVboId);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)offset, (GLsizeiptr)bytes,
+					bullets);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
 
-	// Upload model normal matrix (if locations available)
-	if (material->shader.locs[SHADER_LOC_MATRIX_NORMAL] != -1)
-		rlSetUniformMatrix(material->shader.locs[SHADER_LOC_MATRIX_NORMAL],
-						   MatrixTranspose(MatrixInvert(matModel)));
+// Draw multiple mesh instances with material and different transforms, once
+// for each of the views last passed to scene_uniforms_set_views. The instance
+// data must already be in the mesh's VAO, see ReserveBulletInstances. Draws
+// instances bullets, starting first bullets into the instance buffer, where
+// they are at time. Binds through gl_state and leaves everything bound, so it
+// must be drawn from the render queue. instancesDivisor is the divisor the
+// VAO's instance attributes have, which is only changed when the number of
+// views does. instancesFirst is the bullet they point at, which only moves
+// when the driver can't start drawing partway into the instances by itself.
+void DrawBullets(const Mesh* mesh, const Material* material, uint8_t viewCount,
+				 float time, unsigned int instancesVboId, uint32_t first,
+				 uint32_t instances, uint8_t* instancesDivisor,
+				 uint32_t* instancesFirst)
+{
+	const Shader shader = material->shader;
+	gl_state_use_program(shader.id);
+
+	// Send required data to shader (matrices, values). Most of this is the
+	// same every frame, gl_state skips what the program already has
+	//-----------------------------------------------------
+	// Upload to shader material.colDiffuse
+	const Color diffuse = material->maps[MATERIAL_MAP_DIFFUSE].color;
+	gl_state_set_uniform(shader.locs[SHADER_LOC_COLOR_DIFFUSE],
+						 (float[4]){
+							 (float)diffuse.r / 255.0f,
+							 (float)diffuse.g / 255.0f,
+							 (float)diffuse.b / 255.0f,
+							 (float)diffuse.a / 255.0f,
+						 },
+						 SHADER_UNIFORM_VEC4, 1);
+
+	// Upload to shader material.colSpecular (if location available)
+	const Color specular = material->maps[MATERIAL_MAP_SPECULAR].color;
+	gl_state_set_uniform(shader.locs[SHADER_LOC_COLOR_SPECULAR],
+						 (float[4]){
+							 (float)specular.r / 255.0f,
+							 (float)specular.g / 255.0f,
+							 (float)specular.b / 255.0f,
+							 (float)specular.a / 255.0f,
+						 },
+						 SHADER_UNIFORM_VEC4, 1);
+
+	// NOTE: At this point the modelview matrix just contains the view matrix
+	// (camera) That's because BeginMode3D() sets it and there is no
+	// model-drawing function that modifies it, all use rlPushMatrix() and
+	// rlPopMatrix()
+	gl_state_set_uniform_matrix(shader.locs[SHADER_LOC_MATRIX_VIEW],
+								rlGetMatrixModelview());
+	gl_state_set_uniform_matrix(shader.locs[SHADER_LOC_MATRIX_PROJECTION],
+								rlGetMatrixProjection());
+	// the model matrix is always identity, and so is its normal matrix
+	gl_state_set_uniform_matrix(shader.locs[SHADER_LOC_MATRIX_NORMAL],
+								MatrixIdentity());
+	// where each bullet is comes from how long it has been flying
+	gl_state_set_uniform(shader.locs[BULLET_SHADER_LOC_TIME], &time,
+						 SHADER_UNIFORM_FLOAT, 1);
 	//-----------------------------------------------------
 
 	// Bind active texture maps (if available)
 	for (int i = 0; i < MAX_MATERIAL_MAPS; i++) {
 		if (material->maps[i].texture.id > 0) {
-			// Select current shader texture slot
-			rlActiveTextureSlot(i);
-
-			// Enable texture for active slot
-			if ((i == MATERIAL_MAP_IRRADIANCE) ||
-				(i == MATERIAL_MAP_PREFILTER) || (i == MATERIAL_MAP_CUBEMAP))
-				rlEnableTextureCubemap(material->maps[i].texture.id);
-			else
-				rlEnableTexture(material->maps[i].texture.id);
-
-			rlSetUniform(material->shader.locs[SHADER_LOC_MAP_DIFFUSE + i], &i,
-						 SHADER_UNIFORM_INT, 1);
+			const bool cubemap = (i == MATERIAL_MAP_IRRADIANCE) ||
+								 (i == MATERIAL_MAP_PREFILTER) ||
+								 (i == MATERIAL_MAP_CUBEMAP);
+			gl_state_bind_texture(i,
+								  cubemap ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D,
+								  material->maps[i].texture.id);
+			gl_state_set_uniform(shader.locs[SHADER_LOC_MAP_DIFFUSE + i], &i,
+								 SHADER_UNIFORM_INT, 1);
 		}
 	}
 
-	// Try binding vertex array objects (VAO)
-	// or use VBOs if not possible
-	if (!rlEnableVertexArray(mesh->vaoId)) {
-		// Bind mesh VBO data: vertex position (shader-location = 0)
-		rlEnableVertexBuffer(mesh->vboId[0]);
-		rlSetVertexAttribute(material->shader.locs[SHADER_LOC_VERTEX_POSITION],
-							 3, RL_FLOAT, 0, 0, 0);
-		rlEnableVertexAttribute(
-			material->shader.locs[SHADER_LOC_VERTEX_POSITION]);
-
-		// Bind mesh VBO data: vertex texcoords (shader-location = 1)
-		rlEnableVertexBuffer(mesh->vboId[1]);
-		rlSetVertexAttribute(
-			material->shader.locs[SHADER_LOC_VERTEX_TEXCOORD01], 2, RL_FLOAT, 0,
-			0, 0);
-		rlEnableVertexAttribute(
-			material->shader.locs[SHADER_LOC_VERTEX_TEXCOORD01]);
-
-		if (material->shader.locs[SHADER_LOC_VERTEX_NORMAL] != -1) {
-			// Bind mesh VBO data: vertex normals (shader-location = 2)
-			rlEnableVertexBuffer(mesh->vboId[2]);
-			rlSetVertexAttribute(
-				material->shader.locs[SHADER_LOC_VERTEX_NORMAL], 3, RL_FLOAT, 0,
-				0, 0);
-			rlEnableVertexAttribute(
-				material->shader.locs[SHADER_LOC_VERTEX_NORMAL]);
-		}
-
-		// Bind mesh VBO data: vertex colors (shader-location = 3, if available)
-		if (material->shader.locs[SHADER_LOC_VERTEX_COLOR] != -1) {
-			if (mesh->vboId[3] != 0) {
-				rlEnableVertexBuffer(mesh->vboId[3]);
-				rlSetVertexAttribute(
-					material->shader.locs[SHADER_LOC_VERTEX_COLOR], 4,
-					RL_UNSIGNED_BYTE, 1, 0, 0);
-				rlEnableVertexAttribute(
-					material->shader.locs[SHADER_LOC_VERTEX_COLOR]);
-			} else {
-				// Set default value for unused attribute
-				// NOTE: Required when using default shader and no VAO support
-				float value[4] = {1.0f, 1.0f, 1.0f, 1.0f};
-				rlSetVertexAttributeDefault(
-					material->shader.locs[SHADER_LOC_VERTEX_COLOR], value,
-					SHADER_ATTRIB_VEC4, 4);
-				rlDisableVertexAttribute(
-					material->shader.locs[SHADER_LOC_VERTEX_COLOR]);
-			}
-		}
-
-		// Bind mesh VBO data: vertex tangents (shader-location = 4, if
-		// available)
-		if (material->shader.locs[SHADER_LOC_VERTEX_TANGENT] != -1) {
-			rlEnableVertexBuffer(mesh->vboId[4]);
-			rlSetVertexAttribute(
-				material->shader.locs[SHADER_LOC_VERTEX_TANGENT], 4, RL_FLOAT,
-				0, 0, 0);
-			rlEnableVertexAttribute(
-				material->shader.locs[SHADER_LOC_VERTEX_TANGENT]);
-		}
-
-		// Bind mesh VBO data: vertex texcoords2 (shader-location = 5, if
-		// available)
-		if (material->shader.locs[SHADER_LOC_VERTEX_TEXCOORD02] != -1) {
-			rlEnableVertexBuffer(mesh->vboId[5]);
-			rlSetVertexAttribute(
-				material->shader.locs[SHADER_LOC_VERTEX_TEXCOORD02], 2,
-				RL_FLOAT, 0, 0, 0);
-			rlEnableVertexAttribute(
-				material->shader.locs[SHADER_LOC_VERTEX_TEXCOORD02]);
-		}
-
-		if (mesh->indices != NULL)
-			rlEnableVertexBufferElement(mesh->vboId[6]);
+	// the attributes themselves were set up by ReserveBulletInstances
+	gl_state_bind_vertex_array(mesh->vaoId);
+
+	// Every bullet is drawn once per view, so the instance data only advances
+	// every viewCount instances
+	if (*instancesDivisor != viewCount) {
+		rlSetVertexAttributeDivisor(shader.locs[BULLET_SHADER_LOC_ORIGIN],
+									viewCount);
+		rlSetVertexAttributeDivisor(shader.locs[BULLET_SHADER_LOC_VELOCITY],
+									viewCount);
+		*instancesDivisor = viewCount;
 	}
 
-	// WARNING: Disable vertex attribute color input if mesh can not provide
-	// that data (despite location being enabled in shader)
-	if (mesh->vboId[3] == 0)
-		rlDisableVertexAttribute(
-			material->shader.locs[SHADER_LOC_VERTEX_COLOR]);
-
-	int eyeCount = 1;
-	if (rlIsStereoRenderEnabled())
-		eyeCount = 2;
-
-	for (int eye = 0; eye < eyeCount; eye++) {
-		// Calculate model-view-projection matrix (MVP)
-		Matrix matModelViewProjection = MatrixIdentity();
-		if (eyeCount == 1)
-			matModelViewProjection =
-				MatrixMultiply(matModelView, matProjection);
-		else {
-			// Setup current eye viewport (half screen width)
-			rlViewport(eye * rlGetFramebufferWidth() / 2, 0,
-					   rlGetFramebufferWidth() / 2, rlGetFramebufferHeight());
-			matModelViewProjection = MatrixMultiply(
-				MatrixMultiply(matModelView, rlGetMatrixViewOffsetStereo(eye)),
-				rlGetMatrixProjectionStereo(eye));
-		}
-
-		// Send combined model-view-projection matrix to shader
-		rlSetUniformMatrix(material->shader.locs[SHADER_LOC_MATRIX_MVP],
-						   matModelViewProjection);
-
-		// Draw mesh instanced
+	const bool baseInstance = GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_base_instance;
+	if (baseInstance) {
 		if (mesh->indices != NULL)
-			rlDrawVertexArrayElementsInstanced(0, mesh->triangleCount * 3, 0,
-											   instances);
+			glDrawElementsInstancedBaseInstance(
+				GL_TRIANGLES, mesh->triangleCount * 3, GL_UNSIGNED_SHORT, 0,
+				(GLsizei)(instances * viewCount), first);
 		else
-			rlDrawVertexArrayInstanced(0, mesh->vertexCount, instances);
+			glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0,
+											  mesh->vertexCount,
+											  (GLsizei)(instances * viewCount),
+											  first);
+		return;
 	}
 
-	// Unbind all bound texture maps
-	for (int i = 0; i < MAX_MATERIAL_MAPS; i++) {
-		if (material->maps[i].texture.id > 0) {
-			// Select current shader texture slot
-			rlActiveTextureSlot(i);
-
-			// Disable texture for active slot
-			if ((i == MATERIAL_MAP_IRRADIANCE) ||
-				(i == MATERIAL_MAP_PREFILTER) || (i == MATERIAL_MAP_CUBEMAP))
-				rlDisableTextureCubemap();
-			else
-				rlDisableTexture();
-		}
+	if (*instancesFirst != first) {
+		gl_state_bind_buffer(GL_ARRAY_BUFFER, instancesVboId);
+		PointBulletAttributes(material, first);
+		*instancesFirst = first;
 	}
 
-	// Disable all possible vertex array objects (or VBOs)
-	rlDisableVertexArray();
-	rlDisableVertexBuffer();
-	rlDisableVertexBufferElement();
-
-	// Disable shader program
-	rlDisableShader();
-
-	// Remove instance transforms buffer
-	rlUnloadVertexBuffer(instancesVboId);
+	// Draw mesh instanced
+	if (mesh->indices != NULL)
+		rlDrawVertexArrayElementsInstanced(0, mesh->triangleCount * 3, 0,
+										   (int)(instances * viewCount));
+	else
+		rlDrawVertexArrayInstanced(0, mesh->vertexCount,
+								   (int)(instances * viewCount));
 }
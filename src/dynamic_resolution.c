@@ -0,0 +1,114 @@
+#include "dynamic_resolution.h"
+#include "constants/screen.h"
+#include <math.h>
+#include <raylib.h>
+#include <stdbool.h>
+
+/// how much the scale changes at once
+#define DYNAMIC_RESOLUTION_STEP 0.05f
+/// frames are "over budget" past this fraction of the target, to leave room
+/// for timing jitter
+#define DYNAMIC_RESOLUTION_OVER_BUDGET 1.1f
+/// weight of the newest frame in the smoothed frame time
+#define DYNAMIC_RESOLUTION_SMOOTHING 0.1f
+/// consecutive frames which must make the target before the scale is raised.
+/// with vsync a frame can't report finishing early, so the only way to find
+/// headroom is to try a higher scale after a while
+#define DYNAMIC_RESOLUTION_RAISE_FRAMES 120
+
+static float scale;
+static float smoothed_ms;
+static size_t frames_on_budget;
+static float history[DYNAMIC_RESOLUTION_HISTORY];
+/// where the next scale will be written in history
+static size_t history_next;
+static size_t history_count;
+/// set by dynamic_resolution_pin, along with the scale to go back to
+static bool pinned;
+static float unpinned_scale;
+
+void dynamic_resolution_init()
+{
+	scale = DYNAMIC_RESOLUTION_MAX_SCALE;
+	smoothed_ms = DYNAMIC_RESOLUTION_TARGET_MS;
+	frames_on_budget = 0;
+	history_next = 0;
+	history_count = 0;
+	pinned = false;
+}
+
+void dynamic_resolution_update(float frame_seconds)
+{
+	if (pinned) {
+		return;
+	}
+	static const float over_budget_ms =
+		DYNAMIC_RESOLUTION_TARGET_MS * DYNAMIC_RESOLUTION_OVER_BUDGET;
+	const float frame_ms = frame_seconds * 1000.0f;
+	smoothed_ms += (frame_ms - smoothed_ms) * DYNAMIC_RESOLUTION_SMOOTHING;
+
+	if (frame_ms > over_budget_ms) {
+		frames_on_budget = 0;
+	} else {
+		++frames_on_budget;
+	}
+
+	// drop quickly when frames are consistently slow, but only raise after a
+	// long run of good frames so the scale doesn't oscillate
+	if (smoothed_ms > over_budget_ms &&
+		scale > DYNAMIC_RESOLUTION_MIN_SCALE) {
+		scale = fmaxf(scale - DYNAMIC_RESOLUTION_STEP,
+					  DYNAMIC_RESOLUTION_MIN_SCALE);
+		// give the new scale a chance before judging it
+		smoothed_ms = DYNAMIC_RESOLUTION_TARGET_MS;
+		TraceLog(LOG_DEBUG, "dynamic resolution: lowered scale to %f", scale);
+	} else if (frames_on_budget >= DYNAMIC_RESOLUTION_RAISE_FRAMES &&
+			   scale < DYNAMIC_RESOLUTION_MAX_SCALE) {
+		scale = fminf(scale + DYNAMIC_RESOLUTION_STEP,
+					  DYNAMIC_RESOLUTION_MAX_SCALE);
+		frames_on_budget = 0;
+		TraceLog(LOG_DEBUG, "dynamic resolution: raised scale to %f", scale);
+	}
+
+	history[history_next] = scale;
+	history_next = (history_next + 1) % DYNAMIC_RESOLUTION_HISTORY;
+	if (history_count < DYNAMIC_RESOLUTION_HISTORY) {
+		++history_count;
+	}
+}
+
+float dynamic_resolution_get_scale() { return scale; }
+
+void dynamic_resolution_pin(float pinned_scale)
+{
+	if (!pinned) {
+		unpinned_scale = scale;
+	}
+	scale = pinned_scale;
+	pinned = true;
+}
+
+void dynamic_resolution_unpin()
+{
+	if (!pinned) {
+		return;
+	}
+	scale = unpinned_scale;
+	// judge the old scale on frames from now on
+	smoothed_ms = DYNAMIC_RESOLUTION_TARGET_MS;
+	frames_on_budget = 0;
+	pinned = false;
+}
+
+size_t dynamic_resolution_get_history(float* out, size_t max_frames)
+{
+	const size_t count = max_frames < history_count ? max_frames : history_count;
+	// oldest of the frames being copied
+	size_t index = (history_next + DYNAMIC_RESOLUTION_HISTORY - count) %
+				   DYNAMIC_RESOLUTION_HISTORY;
+	for (size_t i = 0; i < count; ++i) {
+		out[i] = history[index];
+		index = (index + 1) % DYNAMIC_RESOLUTION_HISTORY;
+	}
+	return count;
+}
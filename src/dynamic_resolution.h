@@ -0,0 +1,30 @@
+#pragma once
+#include <stddef.h>
+
+/// Number of frames of scale history kept for
+/// dynamic_resolution_get_history.
+#define DYNAMIC_RESOLUTION_HISTORY 240
+
+/// Start out at full resolution with an empty history.
+void dynamic_resolution_init();
+
+/// Feed in how long the last frame took and maybe change the render scale.
+/// Call once per frame.
+void dynamic_resolution_update(float frame_seconds);
+
+/// The fraction of the full game resolution to render at this frame, between
+/// DYNAMIC_RESOLUTION_MIN_SCALE and DYNAMIC_RESOLUTION_MAX_SCALE.
+float dynamic_resolution_get_scale();
+
+/// Hold the scale at pinned_scale, whatever the frame times, until
+/// dynamic_resolution_unpin. For measurements which need every frame to do
+/// the same amount of work. No history is recorded meanwhile.
+void dynamic_resolution_pin(float pinned_scale);
+
+/// Let the scale follow frame times again, starting from where it was before
+/// dynamic_resolution_pin.
+void dynamic_resolution_unpin();
+
+/// Copy the scale of up to the last max_frames frames into out, oldest first.
+/// Returns the number of frames written.
+size_t dynamic_resolution_get_history(float* out, size_t max_frames);
@@ -0,0 +1,73 @@
+#include "frustum.h"
+#include <math.h>
+#include <stdint.h>
+
+static Vector4 frustum_normalize_plane(Vector4 plane)
+{
+	const float length =
+		sqrtf((plane.x * plane.x) + (plane.y * plane.y) + (plane.z * plane.z));
+	if (length == 0) {
+		return plane;
+	}
+	return (Vector4){plane.x / length, plane.y / length, plane.z / length,
+					 plane.w / length};
+}
+
+Frustum frustum_from_view_projection(Matrix m)
+{
+	// Gribb/Hartmann plane extraction. raylib matrices transform a point as
+	// clip.x = m0*x + m4*y + m8*z + m12, so these are the rows of the matrix
+	const Vector4 row_x = {m.m0, m.m4, m.m8, m.m12};
+	const Vector4 row_y = {m.m1, m.m5, m.m9, m.m13};
+	const Vector4 row_z = {m.m2, m.m6, m.m10, m.m14};
+	const Vector4 row_w = {m.m3, m.m7, m.m11, m.m15};
+
+	Frustum frustum;
+	// left, right
+	frustum.planes[0] =
+		(Vector4){row_w.x + row_x.x, row_w.y + row_x.y, row_w.z + row_x.z,
+				  row_w.w + row_x.w};
+	frustum.planes[1] =
+		(Vector4){row_w.x - row_x.x, row_w.y - row_x.y, row_w.z - row_x.z,
+				  row_w.w - row_x.w};
+	// bottom, top
+	frustum.planes[2] =
+		(Vector4){row_w.x + row_y.x, row_w.y + row_y.y, row_w.z + row_y.z,
+				  row_w.w + row_y.w};
+	frustum.planes[3] =
+		(Vector4){row_w.x - row_y.x, row_w.y - row_y.y, row_w.z - row_y.z,
+				  row_w.w - row_y.w};
+	// near, far
+	frustum.planes[4] =
+		(Vector4){row_w.x + row_z.x, row_w.y + row_z.y, row_w.z + row_z.z,
+				  row_w.w + row_z.w};
+	frustum.planes[5] =
+		(Vector4){row_w.x - row_z.x, row_w.y - row_z.y, row_w.z - row_z.z,
+				  row_w.w - row_z.w};
+
+	for (uint8_t i = 0; i < 6; ++i) {
+		frustum.planes[i] = frustum_normalize_plane(frustum.planes[i]);
+	}
+	return frustum;
+}
+
+bool frustum_intersects_aabb(const Frustum* restrict frustum,
+							 const BoundingBox* restrict box)
+{
+	for (uint8_t i = 0; i < 6; ++i) {
+		const Vector4* plane = &frustum->planes[i];
+		// the corner of the box furthest along the plane normal. if even that
+		// one is behind the plane, the whole box is
+		const Vector3 positive = {
+			plane->x >= 0 ? box->max.x : box->min.x,
+			plane->y >= 0 ? box->max.y : box->min.y,
+			plane->z >= 0 ? box->max.z : box->min.z,
+		};
+		if ((plane->x * positive.x) + (plane->y * positive.y) +
+				(plane->z * positive.z) + plane->w <
+			0) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <raylib.h>
+#include <stdbool.h>
+
+/// Six planes (left, right, bottom, top, near, far) bounding what a camera can
+/// see. Each plane is stored as a normal (xyz) pointing into the frustum and
+/// a distance (w).
+typedef struct
+{
+	Vector4 planes[6];
+} Frustum;
+
+/// Extract the frustum planes from a combined view * projection matrix, as
+/// produced by MatrixMultiply(view, projection).
+Frustum frustum_from_view_projection(Matrix view_projection);
+
+/// Returns false only if the box is entirely outside of the frustum. May
+/// return true for some boxes which are just outside of a corner.
+bool frustum_intersects_aabb(const Frustum* restrict frustum,
+							 const BoundingBox* restrict box);
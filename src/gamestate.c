@@ -1,5 +1,6 @@
 #include "gamestate.h"
 #include "camera.h"
+#include "constants/screen.h"
 #include "threadutils.h"
 #include <assert.h>
 #include <stdatomic.h>
@@ -8,7 +9,8 @@ atomic_bool initialized = false;
 
 Inputstate private_inputs;
 float private_screen_scale;
-FullCamera private_cameras[2];
+/// one for each view, the first NUM_PLANES are the players'
+FullCamera private_cameras[MAX_VIEWS];
 atomic_bool private_inputs_owned;
 atomic_bool private_cameras_owned;
 
@@ -17,7 +19,7 @@ void gamestate_init()
 	assert(!initialized);
 	initialized = true;
 
-	for (uint8_t i = 0; i < 2; ++i) {
+	for (uint8_t i = 0; i < MAX_VIEWS; ++i) {
 		camera_new(&private_cameras[i]);
 	}
 
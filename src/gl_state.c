@@ -0,0 +1,256 @@
+#include "gl_state.h"
+#include <assert.h>
+#include <raymath.h>
+#include <rlgl.h>
+#include <stdbool.h>
+#include <string.h>
+
+/// Stands for a binding which could be anything.
+#define GL_STATE_UNKNOWN UINT32_MAX
+
+/// Programs which can have their uniforms cached at once.
+#define GL_STATE_MAX_PROGRAMS 16
+/// Uniform locations which are cached for each program. Higher locations are
+/// always set.
+#define GL_STATE_MAX_UNIFORMS 32
+/// Biggest uniform value which is cached, one mat4.
+#define GL_STATE_MAX_UNIFORM_BYTES (16 * sizeof(float))
+
+typedef struct
+{
+	/// 0 if this slot is unused
+	unsigned int program;
+	/// size of each cached value, 0 if that location was never set
+	uint8_t sizes[GL_STATE_MAX_UNIFORMS];
+	uint8_t values[GL_STATE_MAX_UNIFORMS][GL_STATE_MAX_UNIFORM_BYTES];
+} ProgramUniforms;
+
+typedef struct
+{
+	unsigned int program;
+	unsigned int vao;
+	unsigned int array_buffer;
+	unsigned int indirect_buffer;
+	unsigned int active_unit;
+	unsigned int textures[GL_STATE_TEXTURE_UNITS];
+} Bindings;
+
+static Bindings bindings = {
+	.program = GL_STATE_UNKNOWN,
+	.vao = GL_STATE_UNKNOWN,
+	.array_buffer = GL_STATE_UNKNOWN,
+	.indirect_buffer = GL_STATE_UNKNOWN,
+	.active_unit = GL_STATE_UNKNOWN,
+};
+static ProgramUniforms program_uniforms[GL_STATE_MAX_PROGRAMS];
+static GlStateStats frame_stats;
+static GlStateStats last_frame_stats;
+
+/// Returns true and counts a skipped call if a binding already has a value,
+/// otherwise records the new value.
+static bool gl_state_same(unsigned int* binding, unsigned int value);
+
+/// Find the uniform cache of a program, claiming a free slot for it if it
+/// doesn't have one yet. NULL if every slot is taken.
+static ProgramUniforms* gl_state_program_uniforms(unsigned int program);
+
+static bool gl_state_same_uniform(int location, const void* value,
+								  size_t size);
+
+static size_t gl_state_uniform_size(int type, int count);
+
+void gl_state_invalidate()
+{
+	bindings.program = GL_STATE_UNKNOWN;
+	bindings.vao = GL_STATE_UNKNOWN;
+	bindings.array_buffer = GL_STATE_UNKNOWN;
+	bindings.indirect_buffer = GL_STATE_UNKNOWN;
+	bindings.active_unit = GL_STATE_UNKNOWN;
+	for (uint8_t i = 0; i < GL_STATE_TEXTURE_UNITS; ++i) {
+		bindings.textures[i] = GL_STATE_UNKNOWN;
+	}
+}
+
+void gl_state_reset()
+{
+	gl_state_use_program(0);
+	gl_state_bind_vertex_array(0);
+	// only ever bound by us, and not a valid target without indirect drawing
+	if (bindings.indirect_buffer != GL_STATE_UNKNOWN &&
+		bindings.indirect_buffer != 0) {
+		gl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	if (!gl_state_same(&bindings.active_unit, 0)) {
+		glActiveTexture(GL_TEXTURE0);
+	}
+	gl_state_invalidate();
+}
+
+void gl_state_use_program(unsigned int program)
+{
+	if (!gl_state_same(&bindings.program, program)) {
+		glUseProgram(program);
+	}
+}
+
+void gl_state_bind_vertex_array(unsigned int vao)
+{
+	if (!gl_state_same(&bindings.vao, vao)) {
+		glBindVertexArray(vao);
+	}
+}
+
+void gl_state_bind_buffer(GLenum target, unsigned int buffer)
+{
+	unsigned int* binding = NULL;
+	switch (target) {
+	case GL_ARRAY_BUFFER:
+		binding = &bindings.array_buffer;
+		break;
+	case GL_DRAW_INDIRECT_BUFFER:
+		binding = &bindings.indirect_buffer;
+		break;
+	default:
+		break;
+	}
+	if (binding == NULL) {
+		++frame_stats.calls_made;
+		glBindBuffer(target, buffer);
+	} else if (!gl_state_same(binding, buffer)) {
+		glBindBuffer(target, buffer);
+	}
+}
+
+void gl_state_bind_texture(uint8_t unit, GLenum target, unsigned int texture)
+{
+	if (unit < GL_STATE_TEXTURE_UNITS &&
+		gl_state_same(&bindings.textures[unit], texture)) {
+		return;
+	}
+	// a cube map and a 2d texture can't have the same name, so the name alone
+	// says what is bound
+	if (!gl_state_same(&bindings.active_unit, unit)) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+	}
+	if (unit >= GL_STATE_TEXTURE_UNITS) {
+		++frame_stats.calls_made;
+	}
+	glBindTexture(target, texture);
+}
+
+void gl_state_set_uniform(int location, const void* value, int type,
+						  int count)
+{
+	if (location < 0) {
+		return;
+	}
+	if (gl_state_same_uniform(location, value,
+							  gl_state_uniform_size(type, count))) {
+		return;
+	}
+	rlSetUniform(location, value, type, count);
+}
+
+void gl_state_set_uniform_matrix(int location, Matrix matrix)
+{
+	if (location < 0) {
+		return;
+	}
+	const float16 values = MatrixToFloatV(matrix);
+	if (gl_state_same_uniform(location, values.v, sizeof(values.v))) {
+		return;
+	}
+	glUniformMatrix4fv(location, 1, GL_FALSE, values.v);
+}
+
+void gl_state_forget_program(unsigned int program)
+{
+	for (uint8_t i = 0; i < GL_STATE_MAX_PROGRAMS; ++i) {
+		if (program_uniforms[i].program == program) {
+			program_uniforms[i] = (ProgramUniforms){0};
+		}
+	}
+}
+
+void gl_state_end_frame()
+{
+	last_frame_stats = frame_stats;
+	frame_stats = (GlStateStats){0};
+}
+
+GlStateStats gl_state_get_stats() { return last_frame_stats; }
+
+static bool gl_state_same(unsigned int* binding, unsigned int value)
+{
+	if (*binding == value) {
+		++frame_stats.calls_avoided;
+		return true;
+	}
+	++frame_stats.calls_made;
+	*binding = value;
+	return false;
+}
+
+static ProgramUniforms* gl_state_program_uniforms(unsigned int program)
+{
+	ProgramUniforms* free_slot = NULL;
+	for (uint8_t i = 0; i < GL_STATE_MAX_PROGRAMS; ++i) {
+		if (program_uniforms[i].program == program) {
+			return &program_uniforms[i];
+		}
+		if (free_slot == NULL && program_uniforms[i].program == 0) {
+			free_slot = &program_uniforms[i];
+		}
+	}
+	if (free_slot != NULL) {
+		free_slot->program = program;
+	}
+	return free_slot;
+}
+
+static bool gl_state_same_uniform(int location, const void* value,
+								  size_t size)
+{
+	// uniforms can only be set on the bound program, so it must be known
+	assert(bindings.program != GL_STATE_UNKNOWN);
+	ProgramUniforms* uniforms =
+		bindings.program == 0 ? NULL
+							  : gl_state_program_uniforms(bindings.program);
+	if (uniforms == NULL || location >= GL_STATE_MAX_UNIFORMS ||
+		size > GL_STATE_MAX_UNIFORM_BYTES) {
+		++frame_stats.calls_made;
+		return false;
+	}
+	if (uniforms->sizes[location] == size &&
+		memcmp(uniforms->values[location], value, size) == 0) {
+		++frame_stats.calls_avoided;
+		return true;
+	}
+	++frame_stats.calls_made;
+	uniforms->sizes[location] = (uint8_t)size;
+	memcpy(uniforms->values[location], value, size);
+	return false;
+}
+
+static size_t gl_state_uniform_size(int type, int count)
+{
+	size_t components = 1;
+	switch (type) {
+	case SHADER_UNIFORM_VEC2:
+	case SHADER_UNIFORM_IVEC2:
+		components = 2;
+		break;
+	case SHADER_UNIFORM_VEC3:
+	case SHADER_UNIFORM_IVEC3:
+		components = 3;
+		break;
+	case SHADER_UNIFORM_VEC4:
+	case SHADER_UNIFORM_IVEC4:
+		components = 4;
+		break;
+	default:
+		break;
+	}
+	// floats and ints are both four bytes
+	return components * sizeof(float) * (size_t)count;
+}
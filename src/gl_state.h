@@ -0,0 +1,54 @@
+#pragma once
+#include <external/glad.h>
+#include <raylib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Texture units whose bindings are tracked. Binding past these always goes
+/// through to GL.
+#define GL_STATE_TEXTURE_UNITS 16
+
+/// GL calls which went through the state cache during the last frame.
+typedef struct
+{
+	/// calls passed on to GL because they changed something
+	size_t calls_made;
+	/// calls skipped because GL already had that state
+	size_t calls_avoided;
+} GlStateStats;
+
+/// Forget every binding the cache knows about, so the next bind of anything
+/// goes through. Call whenever something besides the cache may have touched
+/// GL bindings, which includes anything drawn by raylib. Uniform values are
+/// kept, since they belong to the program.
+void gl_state_invalidate();
+
+/// Unbind the program, vertex array, and any indirect buffer bound through the
+/// cache, and go back to texture unit 0, the way raylib expects to find
+/// things. Also invalidates.
+void gl_state_reset();
+
+void gl_state_use_program(unsigned int program);
+void gl_state_bind_vertex_array(unsigned int vao);
+/// Only GL_ARRAY_BUFFER and GL_DRAW_INDIRECT_BUFFER are tracked, other
+/// targets are always bound.
+void gl_state_bind_buffer(GLenum target, unsigned int buffer);
+/// Bind a texture to a unit, switching the active unit only if needed.
+/// @param target: GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP
+void gl_state_bind_texture(uint8_t unit, GLenum target, unsigned int texture);
+
+/// Set a uniform of the program bound with gl_state_use_program, unless it
+/// already has this value. Only valid for programs whose uniforms are never
+/// set any other way after their first draw.
+/// @param type: one of raylib's ShaderUniformDataType
+void gl_state_set_uniform(int location, const void* value, int type,
+						  int count);
+void gl_state_set_uniform_matrix(int location, Matrix matrix);
+
+/// Drop the uniform values remembered for a program, ie. before unloading it.
+void gl_state_forget_program(unsigned int program);
+
+/// Call once per frame to start counting the next frame's stats.
+void gl_state_end_frame();
+
+GlStateStats gl_state_get_stats();
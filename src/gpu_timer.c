@@ -0,0 +1,191 @@
+#include "gpu_timer.h"
+#include <assert.h>
+#include <external/glad.h>
+#include <raylib.h>
+#include <rlgl.h>
+#include <stdio.h>
+
+/// Sets of queries in flight. A set is read back when it comes around again,
+/// a frame after the GPU was given its last query.
+#define GPU_TIMER_FRAMES 2
+/// Most times one timer can be started in a frame. Any more go untimed.
+#define GPU_TIMER_MAX_SPANS 16
+/// Frames averaged together.
+#define GPU_TIMER_HISTORY 60
+
+/// One frame's timestamp queries, a begin and end for every span.
+typedef struct
+{
+	GLuint queries[GPU_TIMER_COUNT][GPU_TIMER_MAX_SPANS][2];
+	uint8_t span_counts[GPU_TIMER_COUNT];
+	/// which timers are between begin and end
+	bool open[GPU_TIMER_COUNT];
+	/// false until the set has been used for a frame
+	bool issued;
+} GpuTimerFrame;
+
+typedef struct
+{
+	double samples[GPU_TIMER_HISTORY];
+	double sum;
+	size_t next;
+	size_t count;
+} GpuTimerHistory;
+
+static GpuTimerFrame frames[GPU_TIMER_FRAMES];
+static size_t current_frame;
+static GpuTimerHistory histories[GPU_TIMER_COUNT];
+static bool supported;
+static char view_names[MAX_VIEWS][16];
+
+static const char* timer_names[GPU_TIMER_COUNT] = {
+	[GPU_TIMER_SHARED_VIEWS] = "shared views",
+	[GPU_TIMER_SKY] = "sky",
+	[GPU_TIMER_TERRAIN] = "terrain",
+	[GPU_TIMER_DISTANT_TERRAIN] = "distant terrain",
+	[GPU_TIMER_BULLETS] = "bullets",
+	[GPU_TIMER_AIRPLANES] = "airplanes",
+	[GPU_TIMER_WINDOW] = "window",
+};
+
+/// Add up the spans of a frame's timers and add them to the histories.
+/// Returns false without recording anything if any of its queries aren't
+/// done yet.
+static bool gpu_timer_collect(const GpuTimerFrame* frame);
+
+void gpu_timer_init()
+{
+	// timestamps instead of GL_TIME_ELAPSED, since elapsed queries can't be
+	// nested and views contain every other timer
+	supported = GLAD_GL_VERSION_3_3 || GLAD_GL_ARB_timer_query;
+	for (uint8_t i = 0; i < MAX_VIEWS; ++i) {
+		snprintf(view_names[i], sizeof(view_names[i]), "view %d", i + 1);
+		timer_names[GPU_TIMER_VIEW + i] = view_names[i];
+	}
+	if (!supported) {
+		TraceLog(LOG_INFO, "gpu timer: no timer queries, GPU times are off");
+		return;
+	}
+	for (size_t i = 0; i < GPU_TIMER_FRAMES; ++i) {
+		glGenQueries(GPU_TIMER_COUNT * GPU_TIMER_MAX_SPANS * 2,
+					 &frames[i].queries[0][0][0]);
+	}
+}
+
+void gpu_timer_cleanup()
+{
+	if (!supported) {
+		return;
+	}
+	for (size_t i = 0; i < GPU_TIMER_FRAMES; ++i) {
+		glDeleteQueries(GPU_TIMER_COUNT * GPU_TIMER_MAX_SPANS * 2,
+						&frames[i].queries[0][0][0]);
+	}
+}
+
+void gpu_timer_begin_frame()
+{
+	if (!supported) {
+		return;
+	}
+	current_frame = (current_frame + 1) % GPU_TIMER_FRAMES;
+	GpuTimerFrame* frame = &frames[current_frame];
+	if (frame->issued) {
+		gpu_timer_collect(frame);
+	}
+	for (uint8_t i = 0; i < GPU_TIMER_COUNT; ++i) {
+		assert(!frame->open[i]);
+		frame->span_counts[i] = 0;
+	}
+	frame->issued = true;
+}
+
+void gpu_timer_begin(GpuTimer timer)
+{
+	assert(timer < GPU_TIMER_COUNT);
+	if (!supported) {
+		return;
+	}
+	GpuTimerFrame* frame = &frames[current_frame];
+	assert(!frame->open[timer]);
+	if (frame->span_counts[timer] == GPU_TIMER_MAX_SPANS) {
+		return;
+	}
+	rlDrawRenderBatchActive();
+	glQueryCounter(frame->queries[timer][frame->span_counts[timer]][0],
+				   GL_TIMESTAMP);
+	frame->open[timer] = true;
+}
+
+void gpu_timer_end(GpuTimer timer)
+{
+	assert(timer < GPU_TIMER_COUNT);
+	if (!supported) {
+		return;
+	}
+	GpuTimerFrame* frame = &frames[current_frame];
+	if (!frame->open[timer]) {
+		// begin ran out of spans
+		return;
+	}
+	rlDrawRenderBatchActive();
+	glQueryCounter(frame->queries[timer][frame->span_counts[timer]][1],
+				   GL_TIMESTAMP);
+	++frame->span_counts[timer];
+	frame->open[timer] = false;
+}
+
+double gpu_timer_get_average_ms(GpuTimer timer)
+{
+	assert(timer < GPU_TIMER_COUNT);
+	const GpuTimerHistory* history = &histories[timer];
+	return history->count == 0 ? 0 : history->sum / (double)history->count;
+}
+
+const char* gpu_timer_get_name(GpuTimer timer)
+{
+	assert(timer < GPU_TIMER_COUNT);
+	return timer_names[timer];
+}
+
+bool gpu_timer_is_supported() { return supported; }
+
+static bool gpu_timer_collect(const GpuTimerFrame* frame)
+{
+	// checking doesn't wait, unlike asking for a result
+	for (uint8_t i = 0; i < GPU_TIMER_COUNT; ++i) {
+		for (uint8_t span = 0; span < frame->span_counts[i]; ++span) {
+			GLint available = GL_FALSE;
+			glGetQueryObjectiv(frame->queries[i][span][1],
+							   GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available != GL_TRUE) {
+				return false;
+			}
+		}
+	}
+
+	for (uint8_t i = 0; i < GPU_TIMER_COUNT; ++i) {
+		GLuint64 total = 0;
+		for (uint8_t span = 0; span < frame->span_counts[i]; ++span) {
+			GLuint64 begin = 0;
+			GLuint64 end = 0;
+			glGetQueryObjectui64v(frame->queries[i][span][0], GL_QUERY_RESULT,
+								  &begin);
+			glGetQueryObjectui64v(frame->queries[i][span][1], GL_QUERY_RESULT,
+								  &end);
+			total += end - begin;
+		}
+
+		GpuTimerHistory* history = &histories[i];
+		const double sample = (double)total / 1.0e6;
+		if (history->count == GPU_TIMER_HISTORY) {
+			history->sum -= history->samples[history->next];
+		} else {
+			++history->count;
+		}
+		history->samples[history->next] = sample;
+		history->sum += sample;
+		history->next = (history->next + 1) % GPU_TIMER_HISTORY;
+	}
+	return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "constants/screen.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Parts of a frame which get their GPU time measured. Timers can nest, ie.
+/// the sky is timed inside of each view.
+typedef enum
+{
+	/// everything drawn for view n is GPU_TIMER_VIEW + n
+	GPU_TIMER_VIEW = 0,
+	/// all views drawn in one pass, when RENDER_SINGLE_PASS_VIEWS is on
+	GPU_TIMER_SHARED_VIEWS = GPU_TIMER_VIEW + MAX_VIEWS,
+	GPU_TIMER_SKY,
+	GPU_TIMER_TERRAIN,
+	GPU_TIMER_DISTANT_TERRAIN,
+	GPU_TIMER_BULLETS,
+	GPU_TIMER_AIRPLANES,
+	/// post processing and scaling the game onto the window
+	GPU_TIMER_WINDOW,
+	GPU_TIMER_COUNT,
+} GpuTimer;
+
+/// Create the timestamp queries. Needs an OpenGL context.
+void gpu_timer_init();
+
+void gpu_timer_cleanup();
+
+/// Collect the results of the frame which last used this frame's queries, if
+/// the GPU is done with them, and start timing a new frame. Never waits on
+/// the GPU, results which aren't ready yet are dropped.
+void gpu_timer_begin_frame();
+
+/// Start timing some GPU work. Anything raylib has batched up is drawn first
+/// so it doesn't end up in the wrong timer. A timer can be started and ended
+/// several times a frame, the times are added up.
+void gpu_timer_begin(GpuTimer timer);
+
+void gpu_timer_end(GpuTimer timer);
+
+/// Average GPU time per frame over the last GPU_TIMER_HISTORY frames which
+/// were read back, in milliseconds.
+double gpu_timer_get_average_ms(GpuTimer timer);
+
+const char* gpu_timer_get_name(GpuTimer timer);
+
+/// False if the driver has no timer queries, then every average is 0.
+bool gpu_timer_is_supported();
@@ -2,3 +2,7 @@
 
 #define PLANE_MOVE_SPEED 2.0f
 #define PLANE_BOOST_SPEED 4.0f
+
+// debugging keys, raylib KeyboardKey values
+#define DEBUG_OVERLAY_KEY KEY_F3
+#define PROFILE_DUMP_KEY KEY_F4
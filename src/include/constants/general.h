@@ -6,3 +6,13 @@
 #ifndef ASSETS_FOLDER
 #define ASSETS_FOLDER "assets"
 #endif
+
+/// Where linked shader programs are kept between runs, see shader_cache.h
+#ifndef SHADER_CACHE_PATH
+#define SHADER_CACHE_PATH "shader_cache.bin"
+#endif
+
+/// Source spliced into every shader read from a file, see shader_source.h
+#ifndef SHADER_SHARED_SOURCE_PATH
+#define SHADER_SHARED_SOURCE_PATH "assets/materials/scene.glsl"
+#endif
@@ -1,7 +1,32 @@
 #pragma once
+#include "constants/general.h"
 
 #define WINDOW_WIDTH 720
 #define WINDOW_HEIGHT 480
 // the size at which the game is rendered
 #define GAME_WIDTH 540
 #define GAME_HEIGHT 1280
+// most split-screen views drawn at once, laid out in a grid. the first
+// NUM_PLANES follow the players and the rest are spectators, see
+// render_set_view_count
+#define MAX_VIEWS 4
+// render each view straight into its half of the main render texture using
+// viewports, instead of into its own render texture which is then copied over.
+// define as 0 to go back to copying
+#ifndef RENDER_DIRECT_VIEWPORTS
+#define RENDER_DIRECT_VIEWPORTS 1
+#endif
+// draw what all views have in common (terrain and bullets) for every view at
+// once, instancing it for each view, instead of once per view. needs
+// RENDER_DIRECT_VIEWPORTS. off by default
+#ifndef RENDER_SINGLE_PASS_VIEWS
+#define RENDER_SINGLE_PASS_VIEWS 0
+#endif
+#if RENDER_SINGLE_PASS_VIEWS && !RENDER_DIRECT_VIEWPORTS
+#error "RENDER_SINGLE_PASS_VIEWS requires RENDER_DIRECT_VIEWPORTS"
+#endif
+// dynamic resolution: the fraction of GAME_WIDTH x GAME_HEIGHT actually
+// rendered is adjusted between these to keep frames within the target time
+#define DYNAMIC_RESOLUTION_MIN_SCALE 0.5f
+#define DYNAMIC_RESOLUTION_MAX_SCALE 1.0f
+#define DYNAMIC_RESOLUTION_TARGET_MS (1000.0f / 60.0f)
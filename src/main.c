@@ -1,12 +1,23 @@
 #include "airplane.h"
 #include "bullet.h"
 #include "constants/screen.h"
+#include "dynamic_resolution.h"
 #include "gamestate.h"
+#include "gpu_timer.h"
 #include "input.h"
+#include "physics_bench.h"
 #include "render_pipeline.h"
+#include "shader_cache.h"
 #include "skybox.h"
 #include "terrain.h"
 #include "threadutils.h"
+#include <string.h>
+
+/// Frames drawn at each view count before --bench-views starts timing, so
+/// terrain has streamed in and dynamic resolution has settled
+#define BENCH_WARMUP_FRAMES 120
+/// Frames timed at each view count
+#define BENCH_FRAMES 600
 
 // use a function pointer for the update loop so that we can change it
 static void (*update_function)();
@@ -14,11 +25,30 @@ static void (*update_function)();
 // split up code that would normally all be in main()
 static void window_settings();
 static void update();
-static void main_draw();
+/// Gather input, update, and draw one frame.
+static void frame();
+/// Time frames with every number of views from 1 to MAX_VIEWS and log the
+/// results. Returns early if the window is closed.
+static void bench_views();
+static void main_prepare();
+static void main_draw(const RenderView* view);
+static void main_draw_views(const RenderView* views, uint8_t view_count);
 static void defer_update_once() { update_function = &update; }
 
-int main(void)
+int main(int argc, char** argv)
 {
+	bool bench = false;
+	bool bench_bullets = false;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--bench-views") == 0) {
+			bench = true;
+		} else if (strcmp(argv[i], "--bench-bullets") == 0) {
+			bench_bullets = true;
+		} else {
+			TraceLog(LOG_WARNING, "unknown argument %s", argv[i]);
+		}
+	}
+
 	// intialize opengl context first
 	window_settings();
 	// initialize global mutexes (mutices?)
@@ -26,11 +56,14 @@ int main(void)
 
 	// actual game intialization
 	gamestate_init();
+	shader_cache_init();
 	render_pipeline_init();
 	bullet_init();
 	airplane_init();
 	skybox_load();
 	terrain_load();
+	// every shader has been loaded by now
+	shader_cache_save();
 
 	// set the update function to run once without doing anything
 	update_function = defer_update_once;
@@ -39,21 +72,18 @@ int main(void)
 
 	TraceLog(LOG_INFO, "dogfish...");
 
-	bool window_open = true;
-	while (window_open) {
-		if (exit_control_pressed() || WindowShouldClose()) {
-			window_open = false;
+	if (bench_bullets) {
+		physics_bench_run();
+	} else if (bench) {
+		bench_views();
+	} else {
+		bool window_open = true;
+		while (window_open) {
+			if (exit_control_pressed() || WindowShouldClose()) {
+				window_open = false;
+			}
+			frame();
 		}
-
-		render_pipeline_gather_screen_info();
-		// set the variables in gamestate to reflect input state
-		input_gather();
-
-		// update in-game elements before drawing
-		update_function();
-
-		// render both cameras to the window
-		render(main_draw);
 	}
 
 	// cleanup
@@ -62,11 +92,73 @@ int main(void)
 	render_pipeline_cleanup();
 	skybox_cleanup();
 	terrain_cleanup();
+	shader_cache_cleanup();
 	CloseWindow();
 
 	return 0;
 }
 
+static void frame()
+{
+	render_pipeline_gather_screen_info();
+	// set the variables in gamestate to reflect input state
+	input_gather();
+
+	// update in-game elements before drawing
+	update_function();
+
+	// render every camera to the window
+	render(main_prepare, main_draw, main_draw_views);
+}
+
+static void bench_views()
+{
+	// measure how long frames take, not how long until the next vblank
+	SetTargetFPS(0);
+	ClearWindowState(FLAG_VSYNC_HINT);
+	// every view count draws the same number of pixels, otherwise the times
+	// would follow the render scale as much as the view count
+	dynamic_resolution_pin(DYNAMIC_RESOLUTION_MAX_SCALE);
+	for (uint8_t views = 1; views <= MAX_VIEWS; ++views) {
+		render_set_view_count(views);
+		double frame_ms = 0;
+		double prepare_ms = 0;
+		double view_ms = 0;
+		for (size_t i = 0; i < BENCH_WARMUP_FRAMES + BENCH_FRAMES; ++i) {
+			if (WindowShouldClose()) {
+				dynamic_resolution_unpin();
+				return;
+			}
+			const double start = GetTime();
+			frame();
+			if (i < BENCH_WARMUP_FRAMES) {
+				continue;
+			}
+			frame_ms += (GetTime() - start) * 1000.0;
+			const RenderTimings timings = render_get_timings();
+			prepare_ms += timings.prepare_ms;
+			for (uint8_t v = 0; v < views; ++v) {
+				view_ms += timings.view_ms[v];
+			}
+			view_ms += timings.shared_ms;
+		}
+		// rolling averages, which by now only cover this view count
+		double gpu_ms = gpu_timer_get_average_ms(GPU_TIMER_SHARED_VIEWS);
+		for (uint8_t v = 0; v < views; ++v) {
+			gpu_ms += gpu_timer_get_average_ms(GPU_TIMER_VIEW + v);
+		}
+		TraceLog(LOG_INFO,
+				 "bench: %d views, %.3f ms per frame, %.3f ms preparing, "
+				 "%.3f ms drawing views, %.3f ms views on the GPU, %.0f%% "
+				 "resolution",
+				 views, frame_ms / BENCH_FRAMES, prepare_ms / BENCH_FRAMES,
+				 view_ms / BENCH_FRAMES, gpu_ms,
+				 dynamic_resolution_get_scale() * 100.0f);
+	}
+	dynamic_resolution_unpin();
+	render_set_view_count(NUM_PLANES);
+}
+
 /// Perform per-frame game logic.
 void update()
 {
@@ -80,18 +172,33 @@ void update()
 	terrain_update();
 }
 
-/// Draw the in-game objects to a consistently sized rendertexture.
-void main_draw()
+/// Do the drawing work which is the same for every view, once per frame.
+void main_prepare()
 {
-	skybox_draw();
-	terrain_draw();
-	bullet_draw();
+	terrain_prepare();
+	bullet_prepare();
+	airplane_prepare();
+}
+
+/// Draw the in-game objects to a consistently sized rendertexture. The order
+/// here doesn't matter, the render queue sorts it out.
+void main_draw(const RenderView* view)
+{
+	terrain_draw_distant(view);
 	airplane_draw();
+	skybox_draw();
 
-	// grid for visual aid
+	// grid for visual aid, goes out with raylib's batch instead of the queue
 	DrawGrid(10, 1.0f);
 }
 
+/// Draw the in-game objects which can be drawn for several views at once.
+void main_draw_views(const RenderView* views, uint8_t view_count)
+{
+	terrain_draw(views, view_count);
+	bullet_draw(views, view_count);
+}
+
 /// Set windowing backend settings like window title and size.
 static void window_settings()
 {
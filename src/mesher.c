@@ -1,12 +1,19 @@
 #include "mesher.h"
+#include "arena.h"
 #include "quicksort.h"
 #include <assert.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #define VERTEX_PER_QUAD 6
 #define TRI_PER_QUAD 2
 
+// mesh output lives here until it is uploaded, so that streaming terrain in
+// does not have to go through malloc/free for every chunk. one per thread so
+// that chunks can be meshed in parallel
+static _Thread_local Arena mesher_scratch;
+
 /// Initializes a mesher. Does not perform memory allocations
 void mesher_create(Mesher* mesher)
 {
@@ -15,6 +22,15 @@ void mesher_create(Mesher* mesher)
 	mesher->triangle_index = 0;
 	mesher->uv = (Vector2){0};
 	mesher->normal = (Vector3){0};
+	mesher->region_count = 0;
+	mesher->region = 0;
+	// inverted so that the first vertex pushed becomes both min and max
+	mesher->bounds = (BoundingBox){
+		.min = {INFINITY, INFINITY, INFINITY},
+		.max = {-INFINITY, -INFINITY, -INFINITY},
+	};
+	mesher->use_staging = false;
+	mesher->staging = (StagingRange){0};
 
 	// TODO: figure out if this is necessary or (Mesh){0} covers it
 	mesher->inner.vertices = NULL;
@@ -42,6 +58,12 @@ void mesher_allocate(Mesher* mesher, size_t quads)
 	assert(!mesher->allocated);
 	mesher->inner.vertexCount = (int)quads * VERTEX_PER_QUAD;
 	mesher->inner.triangleCount = (int)quads * TRI_PER_QUAD;
+	// the whole mesh is one region unless mesher_allocate_regions says
+	// otherwise
+	mesher->region_count = 1;
+	mesher->region = 0;
+	mesher->region_start[0] = 0;
+	mesher->region_triangles[0] = (size_t)mesher->inner.triangleCount;
 	if (quads == 0) {
 		return;
 	}
@@ -51,23 +73,98 @@ void mesher_allocate(Mesher* mesher, size_t quads)
 	mesher->mesh_texcoord_float_indices = 2 * mesher->inner.vertexCount;
 #endif
 
-	mesher->inner.vertices =
-		RL_MALLOC(sizeof(float) * 3 * mesher->inner.vertexCount);
-	mesher->inner.normals =
-		RL_MALLOC(sizeof(float) * 3 * mesher->inner.vertexCount);
-	mesher->inner.texcoords =
-		RL_MALLOC(sizeof(float) * 2 * mesher->inner.vertexCount);
-	mesher->inner.colors = NULL;
+	const size_t vertex_bytes = sizeof(float) * 3 * mesher->inner.vertexCount;
+	const size_t texcoord_bytes =
+		sizeof(float) * 2 * mesher->inner.vertexCount;
 	// allocate as many indices as there are vertices, then reduce the number
 	// of vertices later
-	mesher->inner.indices =
-		RL_MALLOC(sizeof(unsigned short) * mesher->inner.triangleCount * 3);
+	const size_t index_bytes =
+		sizeof(unsigned short) * mesher->inner.triangleCount * 3;
+
+	if (mesher->use_staging) {
+		mesher->staging =
+			staging_alloc((vertex_bytes * 2) + texcoord_bytes);
+	}
+	const bool staged = mesher->staging.data != NULL;
+
+	// only grows if this is the biggest mesh so far on this thread
+	arena_reserve(&mesher_scratch,
+				  (staged ? 0
+						  : (arena_aligned_size(vertex_bytes) * 2) +
+								arena_aligned_size(texcoord_bytes)) +
+					  arena_aligned_size(index_bytes));
+
+	if (staged) {
+		// same order as the regions of the terrain vertex buffer
+		uint8_t* staged_data = mesher->staging.data;
+		mesher->inner.vertices = (float*)staged_data;
+		mesher->inner.texcoords = (float*)(staged_data + vertex_bytes);
+		mesher->inner.normals =
+			(float*)(staged_data + vertex_bytes + texcoord_bytes);
+	} else {
+		mesher->inner.vertices = arena_alloc(&mesher_scratch, vertex_bytes);
+		mesher->inner.normals = arena_alloc(&mesher_scratch, vertex_bytes);
+		mesher->inner.texcoords =
+			arena_alloc(&mesher_scratch, texcoord_bytes);
+	}
+	mesher->inner.colors = NULL;
+	mesher->inner.indices = arena_alloc(&mesher_scratch, index_bytes);
+	assert(mesher->inner.vertices && mesher->inner.normals &&
+		   mesher->inner.texcoords && mesher->inner.indices);
 #ifndef NDEBUG
 	mesher->optimized = false;
 	mesher->allocated = true;
 #endif
 }
 
+void mesher_use_staging(Mesher* mesher)
+{
+	assert(!mesher->allocated);
+	mesher->use_staging = true;
+}
+
+void mesher_allocate_regions(Mesher* mesher, const size_t* quads,
+							 uint8_t region_count)
+{
+	assert(region_count > 0 && region_count <= MESHER_MAX_REGIONS);
+	size_t total = 0;
+	for (uint8_t i = 0; i < region_count; ++i) {
+		total += quads[i];
+	}
+	mesher_allocate(mesher, total);
+
+	mesher->region_count = region_count;
+	size_t start = 0;
+	for (uint8_t i = 0; i < region_count; ++i) {
+		mesher->region_start[i] = start;
+		mesher->region_triangles[i] = quads[i] * TRI_PER_QUAD;
+		mesher->region_cursor[i] = start;
+		start += mesher->region_triangles[i];
+	}
+	mesher->region = 0;
+	mesher->triangle_index = mesher->region_start[0];
+}
+
+void mesher_set_region(Mesher* mesher, uint8_t region)
+{
+	assert(region < mesher->region_count);
+	assert(mesher->vert_index == 0);
+	if (region == mesher->region) {
+		return;
+	}
+	mesher->region_cursor[mesher->region] = mesher->triangle_index;
+	mesher->triangle_index = mesher->region_cursor[region];
+	mesher->region = region;
+}
+
+void mesher_get_region(const Mesher* mesher, uint8_t region,
+					   size_t* first_vertex, size_t* vertex_count)
+{
+	assert(region < mesher->region_count);
+	*first_vertex = mesher->region_start[region] * 3;
+	*vertex_count = mesher->region_triangles[region] * 3;
+}
+
 /// Add a vertex to the mesh
 void mesher_push_vertex(Mesher* mesher, const Vector3* offset,
 						const Vector3* vertex)
@@ -78,6 +175,8 @@ void mesher_push_vertex(Mesher* mesher, const Vector3* offset,
 		return;
 	}
 	assert(mesher->inner.texcoords != NULL);
+	assert(mesher->triangle_index < mesher->region_start[mesher->region] +
+										mesher->region_triangles[mesher->region]);
 	{
 		size_t index = mesher->triangle_index * 6 + mesher->vert_index * 2;
 		// TODO: make the asserts vs. returns consistent between this and the
@@ -106,9 +205,21 @@ void mesher_push_vertex(Mesher* mesher, const Vector3* offset,
 		size_t index = mesher->triangle_index * 9 + mesher->vert_index * 3;
 		const Vector3 real_offset = offset ? *offset : (Vector3){0};
 		assert(index < mesher->mesh_vertex_float_indices);
-		mesher->inner.vertices[index] = vertex->x + real_offset.x;
-		mesher->inner.vertices[index + 1] = vertex->y + real_offset.y;
-		mesher->inner.vertices[index + 2] = vertex->z + real_offset.z;
+		const Vector3 final = {
+			vertex->x + real_offset.x,
+			vertex->y + real_offset.y,
+			vertex->z + real_offset.z,
+		};
+		mesher->inner.vertices[index] = final.x;
+		mesher->inner.vertices[index + 1] = final.y;
+		mesher->inner.vertices[index + 2] = final.z;
+
+		mesher->bounds.min.x = fminf(mesher->bounds.min.x, final.x);
+		mesher->bounds.min.y = fminf(mesher->bounds.min.y, final.y);
+		mesher->bounds.min.z = fminf(mesher->bounds.min.z, final.z);
+		mesher->bounds.max.x = fmaxf(mesher->bounds.max.x, final.x);
+		mesher->bounds.max.y = fmaxf(mesher->bounds.max.y, final.y);
+		mesher->bounds.max.z = fmaxf(mesher->bounds.max.z, final.z);
 	}
 
 	++mesher->vert_index;
@@ -128,6 +239,10 @@ Mesh mesher_release(Mesher* mesher)
 	return result;
 }
 
+void mesher_scratch_reset() { arena_reset(&mesher_scratch); }
+
+void mesher_scratch_cleanup() { arena_destroy(&mesher_scratch); }
+
 static bool mesher_vertex_sorter(const float* greater, const float* lesser);
 static void mesher_vertex_swap_handler(void* user_data, quicksort_index_t left,
 									   quicksort_index_t right);
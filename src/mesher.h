@@ -1,14 +1,33 @@
 #pragma once
+#include "staging.h"
 #include <raylib.h>
 #include <stddef.h>
+#include <stdint.h>
+
+/// Most contiguous groups of triangles that one mesh can be split into
+#define MESHER_MAX_REGIONS 6
 
 typedef struct
 {
 	Mesh inner;
 	size_t triangle_index;
 	size_t vert_index;
+	/// triangle that each region starts at, and how many triangles it has
+	size_t region_start[MESHER_MAX_REGIONS];
+	size_t region_triangles[MESHER_MAX_REGIONS];
+	/// where triangle_index was left for each region not currently active
+	size_t region_cursor[MESHER_MAX_REGIONS];
+	uint8_t region_count;
+	uint8_t region;
 	Vector2 uv;
 	Vector3 normal;
+	/// box around every vertex pushed so far
+	BoundingBox bounds;
+	/// whether mesher_allocate should try to put vertices in the staging ring
+	bool use_staging;
+	/// where the vertices, texcoords, and normals were put, back to back, if
+	/// they went into the staging ring. data is NULL otherwise
+	StagingRange staging;
 #ifndef NDEBUG
 	bool allocated;
 	bool optimized;
@@ -21,9 +40,31 @@ typedef struct
 /// Initializes a mesher. Does not perform memory allocations
 void mesher_create(Mesher*);
 
-/// Allocates the vertex, normal, and texcoord buffers for a mesher.
+/// Allocates the vertex, normal, and texcoord buffers for a mesher. The
+/// buffers come from a per-thread scratch arena, so they are only valid until
+/// mesher_scratch_reset is called on the same thread.
 void mesher_allocate(Mesher* mesher, size_t quads);
 
+/// Have the next allocation write vertices, texcoords, and normals straight
+/// into the staging ring, so they can be copied to the GPU without another
+/// pass over them. Falls back to the scratch arena if the ring is full, check
+/// mesher->staging before releasing the mesh.
+void mesher_use_staging(Mesher* mesher);
+
+/// Same as mesher_allocate, but splits the mesh into consecutive regions of
+/// quads[i] quads each, so that each region can be drawn separately. Starts
+/// writing into region 0.
+void mesher_allocate_regions(Mesher* mesher, const size_t* quads,
+							 uint8_t region_count);
+
+/// Send the following vertices to a different region. Only valid between
+/// triangles.
+void mesher_set_region(Mesher* mesher, uint8_t region);
+
+/// The range of vertices making up a region, after allocation
+void mesher_get_region(const Mesher* mesher, uint8_t region,
+					   size_t* first_vertex, size_t* vertex_count);
+
 /// Add a vertex to the mesh
 void mesher_push_vertex(Mesher* mesher, const Vector3* offset,
 						const Vector3* vertex);
@@ -33,3 +74,10 @@ Mesh mesher_release(Mesher* mesher);
 
 /// Deduplicate vertices and actually use the index buffer
 void mesher_optimize_for_space(Mesher* mesher);
+
+/// Free every mesh allocated by this thread's meshers. Call once the mesh
+/// has been uploaded and the CPU copy is no longer needed.
+void mesher_scratch_reset();
+
+/// Release the memory backing this thread's scratch arena.
+void mesher_scratch_cleanup();
@@ -0,0 +1,229 @@
+#include "occlusion.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// corners closer than this to the camera can't be projected reliably
+#define OCCLUSION_NEAR_EPSILON 0.01f
+#define BOX_CORNERS 8
+
+/// A box corner after projection. x and y are in depth buffer pixels, depth is
+/// the distance in front of the camera (clip space w).
+typedef struct
+{
+	float x;
+	float y;
+	float depth;
+} ScreenPoint;
+
+static Matrix current_view_projection;
+/// nearest occluder depth seen at each pixel, INFINITY where there is none
+static float depth_buffer[OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT];
+
+/// Project all eight corners of a box. Returns false if any of them are too
+/// close to or behind the camera.
+static bool occlusion_project_box(const BoundingBox* box,
+								  ScreenPoint out[BOX_CORNERS]);
+
+/// Find the outline of the projected box, in counter-clockwise order. Sorts
+/// points in place. Returns the number of points written to hull.
+static size_t occlusion_convex_hull(ScreenPoint points[BOX_CORNERS],
+									ScreenPoint hull[BOX_CORNERS]);
+
+static float occlusion_cross(ScreenPoint origin, ScreenPoint a, ScreenPoint b);
+
+void occlusion_begin(Matrix view_projection)
+{
+	current_view_projection = view_projection;
+	for (size_t i = 0; i < OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT;
+		 ++i) {
+		depth_buffer[i] = INFINITY;
+	}
+}
+
+void occlusion_add_occluder(const BoundingBox* box)
+{
+	ScreenPoint corners[BOX_CORNERS];
+	if (!occlusion_project_box(box, corners)) {
+		return;
+	}
+
+	float farthest = 0;
+	for (uint8_t i = 0; i < BOX_CORNERS; ++i) {
+		farthest = fmaxf(farthest, corners[i].depth);
+	}
+
+	ScreenPoint hull[BOX_CORNERS];
+	const size_t hull_size = occlusion_convex_hull(corners, hull);
+	if (hull_size < 3) {
+		return;
+	}
+
+	float min_x = INFINITY;
+	float min_y = INFINITY;
+	float max_x = -INFINITY;
+	float max_y = -INFINITY;
+	for (size_t i = 0; i < hull_size; ++i) {
+		min_x = fminf(min_x, hull[i].x);
+		min_y = fminf(min_y, hull[i].y);
+		max_x = fmaxf(max_x, hull[i].x);
+		max_y = fmaxf(max_y, hull[i].y);
+	}
+	const int start_x = (int)fmaxf(ceilf(min_x), 0);
+	const int start_y = (int)fmaxf(ceilf(min_y), 0);
+	const int end_x = (int)fminf(floorf(max_x), OCCLUSION_BUFFER_WIDTH);
+	const int end_y = (int)fminf(floorf(max_y), OCCLUSION_BUFFER_HEIGHT);
+	if (start_x >= end_x || start_y >= end_y) {
+		return;
+	}
+
+	// a pixel is only covered if all four of its corners are inside of the
+	// outline, so figure out which pixel corners are inside first. each row
+	// of pixels only needs the corner row above and below it
+	bool corners_inside[2][OCCLUSION_BUFFER_WIDTH + 1];
+	for (int y = start_y; y <= end_y; ++y) {
+		bool* row = corners_inside[y & 1];
+		for (int x = start_x; x <= end_x; ++x) {
+			const ScreenPoint point = {(float)x, (float)y, 0};
+			bool inside = true;
+			for (size_t i = 0; i < hull_size && inside; ++i) {
+				inside = occlusion_cross(hull[i], hull[(i + 1) % hull_size],
+										 point) >= 0;
+			}
+			row[x] = inside;
+		}
+
+		if (y == start_y) {
+			continue;
+		}
+
+		const bool* above = corners_inside[(y - 1) & 1];
+		float* depth_row = &depth_buffer[(y - 1) * OCCLUSION_BUFFER_WIDTH];
+		for (int x = start_x; x < end_x; ++x) {
+			if (above[x] && above[x + 1] && row[x] && row[x + 1]) {
+				depth_row[x] = fminf(depth_row[x], farthest);
+			}
+		}
+	}
+}
+
+bool occlusion_is_visible(const BoundingBox* box)
+{
+	ScreenPoint corners[BOX_CORNERS];
+	if (!occlusion_project_box(box, corners)) {
+		return true;
+	}
+
+	float nearest = INFINITY;
+	float min_x = INFINITY;
+	float min_y = INFINITY;
+	float max_x = -INFINITY;
+	float max_y = -INFINITY;
+	for (uint8_t i = 0; i < BOX_CORNERS; ++i) {
+		nearest = fminf(nearest, corners[i].depth);
+		min_x = fminf(min_x, corners[i].x);
+		min_y = fminf(min_y, corners[i].y);
+		max_x = fmaxf(max_x, corners[i].x);
+		max_y = fmaxf(max_y, corners[i].y);
+	}
+
+	// every pixel the box touches at all
+	const int start_x = (int)fmaxf(floorf(min_x), 0);
+	const int start_y = (int)fmaxf(floorf(min_y), 0);
+	const int end_x = (int)fminf(ceilf(max_x), OCCLUSION_BUFFER_WIDTH);
+	const int end_y = (int)fminf(ceilf(max_y), OCCLUSION_BUFFER_HEIGHT);
+	if (start_x >= end_x || start_y >= end_y) {
+		// off screen, leave that to frustum culling
+		return true;
+	}
+
+	for (int y = start_y; y < end_y; ++y) {
+		const float* depth_row = &depth_buffer[y * OCCLUSION_BUFFER_WIDTH];
+		for (int x = start_x; x < end_x; ++x) {
+			if (depth_row[x] >= nearest) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static bool occlusion_project_box(const BoundingBox* box,
+								  ScreenPoint out[BOX_CORNERS])
+{
+	const Matrix m = current_view_projection;
+	for (uint8_t i = 0; i < BOX_CORNERS; ++i) {
+		const Vector3 corner = {
+			(i & 1) ? box->max.x : box->min.x,
+			(i & 2) ? box->max.y : box->min.y,
+			(i & 4) ? box->max.z : box->min.z,
+		};
+		const float clip_x = (m.m0 * corner.x) + (m.m4 * corner.y) +
+							 (m.m8 * corner.z) + m.m12;
+		const float clip_y = (m.m1 * corner.x) + (m.m5 * corner.y) +
+							 (m.m9 * corner.z) + m.m13;
+		const float clip_w = (m.m3 * corner.x) + (m.m7 * corner.y) +
+							 (m.m11 * corner.z) + m.m15;
+		if (clip_w < OCCLUSION_NEAR_EPSILON) {
+			return false;
+		}
+		out[i] = (ScreenPoint){
+			.x = ((clip_x / clip_w) * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH,
+			.y = ((clip_y / clip_w) * 0.5f + 0.5f) * OCCLUSION_BUFFER_HEIGHT,
+			.depth = clip_w,
+		};
+	}
+	return true;
+}
+
+static float occlusion_cross(ScreenPoint origin, ScreenPoint a, ScreenPoint b)
+{
+	return ((a.x - origin.x) * (b.y - origin.y)) -
+		   ((a.y - origin.y) * (b.x - origin.x));
+}
+
+static size_t occlusion_convex_hull(ScreenPoint points[BOX_CORNERS],
+									ScreenPoint hull[BOX_CORNERS])
+{
+	// monotone chain. insertion sort is fine for eight points
+	for (uint8_t i = 1; i < BOX_CORNERS; ++i) {
+		const ScreenPoint key = points[i];
+		int j = i - 1;
+		while (j >= 0 && (points[j].x > key.x ||
+						  (points[j].x == key.x && points[j].y > key.y))) {
+			points[j + 1] = points[j];
+			--j;
+		}
+		points[j + 1] = key;
+	}
+
+	// the hull needs room for the duplicated endpoint while it is being built
+	ScreenPoint chain[(BOX_CORNERS * 2) + 1];
+	size_t count = 0;
+	// lower half
+	for (uint8_t i = 0; i < BOX_CORNERS; ++i) {
+		while (count >= 2 &&
+			   occlusion_cross(chain[count - 2], chain[count - 1], points[i]) <=
+				   0) {
+			--count;
+		}
+		chain[count++] = points[i];
+	}
+	// upper half
+	const size_t lower_count = count + 1;
+	for (int i = BOX_CORNERS - 2; i >= 0; --i) {
+		while (count >= lower_count &&
+			   occlusion_cross(chain[count - 2], chain[count - 1], points[i]) <=
+				   0) {
+			--count;
+		}
+		chain[count++] = points[i];
+	}
+	// last point is the same as the first
+	--count;
+
+	for (size_t i = 0; i < count; ++i) {
+		hull[i] = chain[i];
+	}
+	return count;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <raylib.h>
+#include <stdbool.h>
+
+/// Resolution of the software depth buffer. Low on purpose, occluders and
+/// occludees are whole chunks so fine detail buys nothing.
+#define OCCLUSION_BUFFER_WIDTH 64
+#define OCCLUSION_BUFFER_HEIGHT 64
+
+/// Clear the depth buffer and start culling against a new camera, given its
+/// view * projection matrix as produced by MatrixMultiply(view, projection).
+void occlusion_begin(Matrix view_projection);
+
+/// Rasterize a box which is known to be completely solid into the depth
+/// buffer. Everything inside of the box's outline on screen is considered to be
+/// as far away as its farthest corner, so it never hides anything it shouldn't.
+/// Boxes crossing the near plane are ignored.
+void occlusion_add_occluder(const BoundingBox* box);
+
+/// Returns false only if the box is completely hidden behind the occluders
+/// added since occlusion_begin.
+bool occlusion_is_visible(const BoundingBox* box);
@@ -1,5 +1,49 @@
 #include "physics.h"
 
+// The bodies physics_batch_sweep_and_move sweeps at once, and the operations
+// it needs on that many floats
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SWEEP_LANES 8
+typedef __m256 SweepLanes;
+#define sweep_load(p) _mm256_loadu_ps(p)
+#define sweep_set(x) _mm256_set1_ps(x)
+#define sweep_add(a, b) _mm256_add_ps(a, b)
+#define sweep_sub(a, b) _mm256_sub_ps(a, b)
+#define sweep_mul(a, b) _mm256_mul_ps(a, b)
+#define sweep_div(a, b) _mm256_div_ps(a, b)
+#define sweep_min(a, b) _mm256_min_ps(a, b)
+#define sweep_max(a, b) _mm256_max_ps(a, b)
+/// bit n is set if lane n entered before it exited
+#define sweep_hits(enter, exit)                                                \
+	_mm256_movemask_ps(_mm256_cmp_ps(enter, exit, _CMP_LE_OQ))
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SWEEP_LANES 4
+typedef __m128 SweepLanes;
+#define sweep_load(p) _mm_loadu_ps(p)
+#define sweep_set(x) _mm_set1_ps(x)
+#define sweep_add(a, b) _mm_add_ps(a, b)
+#define sweep_sub(a, b) _mm_sub_ps(a, b)
+#define sweep_mul(a, b) _mm_mul_ps(a, b)
+#define sweep_div(a, b) _mm_div_ps(a, b)
+#define sweep_min(a, b) _mm_min_ps(a, b)
+#define sweep_max(a, b) _mm_max_ps(a, b)
+#define sweep_hits(enter, exit) _mm_movemask_ps(_mm_cmple_ps(enter, exit))
+#else
+#define SWEEP_LANES 1
+typedef float SweepLanes;
+#define sweep_load(p) (*(p))
+#define sweep_set(x) (x)
+#define sweep_add(a, b) ((a) + (b))
+#define sweep_sub(a, b) ((a) - (b))
+#define sweep_mul(a, b) ((a) * (b))
+#define sweep_div(a, b) ((a) / (b))
+#define sweep_min(a, b) fminf(a, b)
+#define sweep_max(a, b) fmaxf(a, b)
+#define sweep_hits(enter, exit) ((int)((enter) <= (exit)))
+#endif
+
 /// Construct an AABB for a sphere of a given radius
 AABB physics_aabb_from_sphere(float radius)
 {
@@ -228,6 +272,216 @@ void physics_batch_collide_and_move(
 	}
 }
 
+/// Sweep a point from start to start + delta against a box with half extents
+/// extents around center. Returns false if it misses, otherwise fills the
+/// contact with the face it entered through and the length of the path past
+/// it. A path starting inside the box enters at its start.
+static bool sweep(Vector3 start, Vector3 delta, Vector3 center,
+				  Vector3 extents, Contact* restrict contact)
+{
+	const float from_center[3] = {start.x - center.x, start.y - center.y,
+								  start.z - center.z};
+	const float direction[3] = {delta.x, delta.y, delta.z};
+	const float half[3] = {extents.x, extents.y, extents.z};
+	// slab test, how far along the path it is inside all three axes' slabs
+	float path_enter = -INFINITY;
+	float path_exit = INFINITY;
+	int8_t enter_axis = -1;
+	for (uint8_t axis = 0; axis < 3; ++axis) {
+		if (fabsf(direction[axis]) < 1.0e-8f) {
+			// parallel to this slab, so always or never inside it
+			if (fabsf(from_center[axis]) > half[axis]) {
+				return false;
+			}
+			continue;
+		}
+		float slab_enter = (-half[axis] - from_center[axis]) / direction[axis];
+		float slab_exit = (half[axis] - from_center[axis]) / direction[axis];
+		if (slab_enter > slab_exit) {
+			const float swap = slab_enter;
+			slab_enter = slab_exit;
+			slab_exit = swap;
+		}
+		if (slab_enter > path_enter) {
+			path_enter = slab_enter;
+			enter_axis = (int8_t)axis;
+		}
+		path_exit = fminf(path_exit, slab_exit);
+		if (path_enter > path_exit) {
+			return false;
+		}
+	}
+	if (path_exit < 0.0f || path_enter > 1.0f) {
+		return false;
+	}
+
+	float normal[3] = {0};
+	if (enter_axis >= 0) {
+		normal[enter_axis] = direction[enter_axis] > 0.0f ? -1.0f : 1.0f;
+	}
+	contact->collision = (Vector3){normal[0], normal[1], normal[2]};
+	contact->depth = (1.0f - fmaxf(path_enter, 0.0f)) * Vector3Length(delta);
+	return true;
+}
+
+uint8_t physics_sweep_lanes() { return SWEEP_LANES; }
+
+/// Where the body at index in batch started and how far it went, flying from
+/// from (or its spawn time, if later) until to.
+static void trajectory_path(const TrajectoryBatch* restrict batch,
+							uint16_t index, float from, float to,
+							Vector3* restrict start, Vector3* restrict delta)
+{
+	const float spawn_time = batch->spawn_time[index];
+	const float start_time = fmaxf(from, spawn_time);
+	const Vector3 origin = {batch->origin[0][index], batch->origin[1][index],
+							batch->origin[2][index]};
+	const Vector3 velocity = {batch->velocity[0][index],
+							  batch->velocity[1][index],
+							  batch->velocity[2][index]};
+	*start = Vector3Add(origin, Vector3Scale(velocity, start_time - spawn_time));
+	*delta = Vector3Scale(velocity, to - start_time);
+}
+
+/// Sweep one body of batch1 against one box and call the handler if it hits.
+/// Returns false if the handler cancelled.
+static bool sweep_one(const TrajectoryBatch* restrict batch1, uint16_t outer,
+					  uint16_t inner, float from, float to, Vector3 center,
+					  Vector3 extents, CollisionHandler handler)
+{
+	if (batch1->spawn_time[outer] < 0.0f) {
+		// removed
+		return true;
+	}
+	Vector3 start;
+	Vector3 delta;
+	trajectory_path(batch1, outer, from, to, &start, &delta);
+	Contact contact;
+	if (!sweep(start, delta, center, extents, &contact)) {
+		return true;
+	}
+	switch (handler(outer, inner, &contact)) {
+	case CANCEL:
+		return false;
+	case CONTINUE:
+		break;
+	default:
+		TraceLog(LOG_WARNING, "Invalid return code, corruption?");
+		break;
+	}
+	return true;
+}
+
+void physics_batch_sweep_and_move(
+	const AABB* restrict aabb1, const TrajectoryBatch* restrict batch1,
+	float from, float to, const AABBBatchOptions* restrict batch2,
+	const Vector3BatchOptions* restrict position_batch2,
+	const QuaternionBatchOptions* restrict direction_batch2,
+	const FloatBatchOptions* restrict speed_batch2, CollisionHandler handler)
+{
+	const bool batch2_same_speed = speed_batch2->count == 0;
+	assert(batch2_same_speed || batch2->count == speed_batch2->count);
+	assert(direction_batch2->stride % sizeof(float) == 0);
+
+	// the AABBs are swept against where they end up
+	for (uint16_t i = 0; i < position_batch2->count; ++i) {
+		Vector3* pos = (Vector3*)((uint8_t*)position_batch2->first +
+								  ((ptrdiff_t)i * position_batch2->stride));
+		move(pos, i, direction_batch2, speed_batch2, batch2_same_speed);
+	}
+	physics_batch_sweep(aabb1, batch1, from, to, batch2, position_batch2,
+						handler);
+}
+
+void physics_batch_sweep(const AABB* restrict aabb1,
+						 const TrajectoryBatch* restrict batch1, float from,
+						 float to, const AABBBatchOptions* restrict batch2,
+						 const Vector3BatchOptions* restrict position_batch2,
+						 CollisionHandler handler)
+{
+	const bool batch2_same_aabb = batch2->count == 0;
+	assert(batch2_same_aabb || batch2->count == position_batch2->count);
+	assert(position_batch2->stride % sizeof(float) == 0);
+	assert(from <= to);
+
+	const SweepLanes from_lanes = sweep_set(from);
+	const SweepLanes to_lanes = sweep_set(to);
+	const SweepLanes zero = sweep_set(0.0f);
+	const SweepLanes one = sweep_set(1.0f);
+
+	// there are only ever a few AABBs, so sweep every body against one box
+	// at a time, which keeps the box in registers
+	for (uint16_t inner = 0; inner < position_batch2->count; ++inner) {
+		const AABB* inner_aabb =
+			batch2_same_aabb
+				? batch2->first
+				: (AABB*)((uint8_t*)batch2->first +
+						  ((ptrdiff_t)inner * batch2->stride));
+		const Vector3 center =
+			*(Vector3*)((uint8_t*)position_batch2->first +
+						((ptrdiff_t)inner * position_batch2->stride));
+		// a box swept along the path hits wherever the path hits the other
+		// box grown by its size
+		const Vector3 extents = Vector3Add(*aabb1, *inner_aabb);
+		const float center_axes[3] = {center.x, center.y, center.z};
+		const float half_axes[3] = {extents.x, extents.y, extents.z};
+
+		uint16_t outer = 0;
+		for (; outer + SWEEP_LANES <= batch1->count; outer += SWEEP_LANES) {
+			const SweepLanes spawn_time =
+				sweep_load(&batch1->spawn_time[outer]);
+			const SweepLanes start_time = sweep_max(from_lanes, spawn_time);
+			const SweepLanes flown = sweep_sub(start_time, spawn_time);
+			const SweepLanes duration = sweep_sub(to_lanes, start_time);
+			// slab test like sweep, for every lane at once, starting out with
+			// the part of the path flown this time. a path parallel to a slab
+			// divides by zero, which gives infinities that put it always or
+			// never inside the slab, as it should be
+			SweepLanes enter = zero;
+			SweepLanes exit = one;
+			for (uint8_t axis = 0; axis < 3; ++axis) {
+				const SweepLanes velocity =
+					sweep_load(&batch1->velocity[axis][outer]);
+				const SweepLanes from_center = sweep_sub(
+					sweep_add(sweep_load(&batch1->origin[axis][outer]),
+							  sweep_mul(velocity, flown)),
+					sweep_set(center_axes[axis]));
+				const SweepLanes inverse =
+					sweep_div(one, sweep_mul(velocity, duration));
+				const SweepLanes a = sweep_mul(
+					sweep_sub(sweep_set(-half_axes[axis]), from_center),
+					inverse);
+				const SweepLanes b = sweep_mul(
+					sweep_sub(sweep_set(half_axes[axis]), from_center),
+					inverse);
+				enter = sweep_max(enter, sweep_min(a, b));
+				exit = sweep_min(exit, sweep_max(a, b));
+			}
+			// removed bodies have negative spawn times
+			const int hits = sweep_hits(enter, exit) &
+							 sweep_hits(zero, spawn_time);
+			if (hits == 0) {
+				continue;
+			}
+			// hits are rare, redo them one at a time to get the contact
+			for (uint8_t lane = 0; lane < SWEEP_LANES; ++lane) {
+				if ((hits & (1 << lane)) != 0 &&
+					!sweep_one(batch1, outer + lane, inner, from, to, center,
+							   extents, handler)) {
+					return;
+				}
+			}
+		}
+		// whatever doesn't fill a whole set of lanes
+		for (; outer < batch1->count; ++outer) {
+			if (!sweep_one(batch1, outer, inner, from, to, center, extents,
+						   handler)) {
+				return;
+			}
+		}
+	}
+}
+
 // stolen from
 // https://gamedev.stackexchange.com/questions/129446/how-can-i-calculate-the-penetration-depth-between-two-colliding-3d-aabbs
 
@@ -64,6 +64,19 @@ typedef struct
 	uint8_t stride;
 } FloatBatchOptions;
 
+/// Bodies which fly in a straight line, each at
+/// origin + velocity * (time - spawn_time). Each component is its own array,
+/// so several bodies can be worked on at once. A body with a negative spawn
+/// time has been removed, and never collides.
+typedef struct
+{
+	/// x, y and z arrays
+	const float* origin[3];
+	const float* velocity[3];
+	const float* spawn_time;
+	uint16_t count;
+} TrajectoryBatch;
+
 // arbitrarily large prime number
 #define NOSTRIDE 101
 
@@ -110,6 +123,31 @@ void physics_batch_collide_and_move(
 	const FloatBatchOptions* restrict speed_batch1,
 	const FloatBatchOptions* restrict speed_batch2, CollisionHandler handler);
 
+/// Collide bodies which fly in a straight line, whose positions are never
+/// stored, with a batch of AABBs. The path each body in batch1 took between
+/// from and to (or its spawn time, if later) is swept against the AABBs,
+/// several bodies at a time with SSE or AVX2 when the target has them. All of
+/// batch1 shares aabb1. The handler's contact is the face of the AABB the path
+/// entered through, and how far along the path went past it.
+void physics_batch_sweep(const AABB* restrict aabb1,
+						 const TrajectoryBatch* restrict batch1, float from,
+						 float to, const AABBBatchOptions* restrict batch2,
+						 const Vector3BatchOptions* restrict position_batch2,
+						 CollisionHandler handler);
+
+/// Move a batch of AABBs like physics_batch_collide_and_move does, then
+/// physics_batch_sweep bodies against them where they end up.
+/// DO NOT pass in the same pointer to any of these options.
+void physics_batch_sweep_and_move(
+	const AABB* restrict aabb1, const TrajectoryBatch* restrict batch1,
+	float from, float to, const AABBBatchOptions* restrict batch2,
+	const Vector3BatchOptions* restrict position_batch2,
+	const QuaternionBatchOptions* restrict direction_batch2,
+	const FloatBatchOptions* restrict speed_batch2, CollisionHandler handler);
+
+/// How many bodies physics_batch_sweep_and_move sweeps at once.
+uint8_t physics_sweep_lanes();
+
 /// Separating Axis Theorem implementation
 bool physics_sat(const Vector3* restrict axis, float minA, float maxA,
 				 float minB, float maxB, Vector3* restrict mtvAxis,
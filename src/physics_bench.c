@@ -0,0 +1,193 @@
+#include "physics_bench.h"
+#include "physics.h"
+#include "shorthand.h"
+#include "threadutils.h"
+#include <stdlib.h>
+
+/// Frames timed at each bullet count
+#define PHYSICS_BENCH_FRAMES 100
+#define PHYSICS_BENCH_FRAME_TIME (1.0f / 60.0f)
+/// Units per second, about what bullets fly at
+#define PHYSICS_BENCH_SPEED 60.0f
+/// Bullets are spread through a cube this many units across
+#define PHYSICS_BENCH_SPREAD 400.0f
+/// Bodies the bullets are collided with, like the airplanes
+#define PHYSICS_BENCH_BODIES 2
+/// Batches hold at most UINT16_MAX bodies, so more are done in pieces
+#define PHYSICS_BENCH_CHUNK 50000
+
+/// A bullet as it used to be stored, moved every frame.
+typedef struct
+{
+	Vector3 position;
+	Quaternion direction;
+} LegacyBullet;
+
+static size_t hits;
+
+static CollisionHandlerReturnCode physics_bench_on_collision(uint16_t bullet,
+															 uint16_t body,
+															 Contact* contact)
+{
+	UNUSED(bullet);
+	UNUSED(body);
+	UNUSED(contact);
+	++hits;
+	return CONTINUE;
+}
+
+static float physics_bench_random(float min, float max)
+{
+	return min + ((float)rand() / (float)RAND_MAX) * (max - min);
+}
+
+/// Time count bullets both ways and log how long a frame of each took.
+static void physics_bench_count(size_t count)
+{
+	LegacyBullet* legacy = RL_MALLOC(count * sizeof(LegacyBullet));
+	CHECKMEM(legacy);
+	float* fields = RL_MALLOC(count * 7 * sizeof(float));
+	CHECKMEM(fields);
+	float* origin[3] = {fields, fields + count, fields + (count * 2)};
+	float* velocity[3] = {fields + (count * 3), fields + (count * 4),
+						  fields + (count * 5)};
+	float* spawn_time = fields + (count * 6);
+
+	const float half_spread = PHYSICS_BENCH_SPREAD / 2.0f;
+	for (size_t i = 0; i < count; ++i) {
+		const Vector3 position = {
+			physics_bench_random(-half_spread, half_spread),
+			physics_bench_random(-half_spread, half_spread),
+			physics_bench_random(-half_spread, half_spread),
+		};
+		const Vector3 axis = Vector3Normalize((Vector3){
+			physics_bench_random(-1, 1),
+			physics_bench_random(-1, 1),
+			physics_bench_random(-1, 1),
+		});
+		const Quaternion direction =
+			QuaternionFromAxisAngle(axis, physics_bench_random(0, 2 * PI));
+		const Vector3 flying = Vector3RotateByQuaternion(
+			(Vector3){PHYSICS_BENCH_SPEED, 0, 0}, direction);
+		legacy[i] = (LegacyBullet){
+			.position = position,
+			.direction = direction,
+		};
+		origin[0][i] = position.x;
+		origin[1][i] = position.y;
+		origin[2][i] = position.z;
+		velocity[0][i] = flying.x;
+		velocity[1][i] = flying.y;
+		velocity[2][i] = flying.z;
+		spawn_time[i] = 0;
+	}
+
+	// big enough that some bullets hit them now and then
+	AABB body_aabbs[PHYSICS_BENCH_BODIES] = {{5, 5, 5}, {5, 5, 5}};
+	Vector3 body_positions[PHYSICS_BENCH_BODIES] = {{0, 0, 0}, {50, 0, 0}};
+	Quaternion body_directions[PHYSICS_BENCH_BODIES] = {QuaternionIdentity(),
+														QuaternionIdentity()};
+	float body_speed = 0;
+	const AABBBatchOptions bodies = {
+		.first = body_aabbs,
+		.count = PHYSICS_BENCH_BODIES,
+		.stride = sizeof(AABB),
+	};
+	const Vector3BatchOptions body_position_options = {
+		.first = body_positions,
+		.count = PHYSICS_BENCH_BODIES,
+		.stride = sizeof(Vector3),
+	};
+	const QuaternionBatchOptions body_direction_options = {
+		.first = body_directions,
+		.count = PHYSICS_BENCH_BODIES,
+		.stride = sizeof(Quaternion),
+	};
+	const FloatBatchOptions body_speed_options = {
+		.first = &body_speed,
+		.count = 0,
+		.stride = NOSTRIDE,
+	};
+	AABB bullet_aabb = {0.1f, 0.1f, 0.5f};
+	// the old bullets moved this far every frame
+	float legacy_speed = PHYSICS_BENCH_SPEED * PHYSICS_BENCH_FRAME_TIME;
+
+	hits = 0;
+	double start = GetTime();
+	for (size_t frame = 0; frame < PHYSICS_BENCH_FRAMES; ++frame) {
+		for (size_t first = 0; first < count; first += PHYSICS_BENCH_CHUNK) {
+			const uint16_t chunk = count - first < PHYSICS_BENCH_CHUNK
+									   ? count - first
+									   : PHYSICS_BENCH_CHUNK;
+			const AABBBatchOptions bullet_aabbs = {
+				.first = &bullet_aabb,
+				.count = 0,
+				.stride = NOSTRIDE,
+			};
+			const Vector3BatchOptions positions = {
+				.first = &legacy[first].position,
+				.count = chunk,
+				.stride = sizeof(LegacyBullet),
+			};
+			const QuaternionBatchOptions directions = {
+				.first = &legacy[first].direction,
+				.count = chunk,
+				.stride = sizeof(LegacyBullet),
+			};
+			const FloatBatchOptions speeds = {
+				.first = &legacy_speed,
+				.count = 0,
+				.stride = NOSTRIDE,
+			};
+			physics_batch_collide_and_move(
+				&bullet_aabbs, &bodies, &positions, &body_position_options,
+				&directions, &body_direction_options, &speeds,
+				&body_speed_options, physics_bench_on_collision);
+		}
+	}
+	const double legacy_ms =
+		(GetTime() - start) * 1000.0 / PHYSICS_BENCH_FRAMES;
+	const size_t legacy_hits = hits;
+
+	hits = 0;
+	start = GetTime();
+	for (size_t frame = 0; frame < PHYSICS_BENCH_FRAMES; ++frame) {
+		const float from = (float)frame * PHYSICS_BENCH_FRAME_TIME;
+		for (size_t first = 0; first < count; first += PHYSICS_BENCH_CHUNK) {
+			const TrajectoryBatch trajectories = {
+				.origin = {&origin[0][first], &origin[1][first],
+						   &origin[2][first]},
+				.velocity = {&velocity[0][first], &velocity[1][first],
+							 &velocity[2][first]},
+				.spawn_time = &spawn_time[first],
+				.count = count - first < PHYSICS_BENCH_CHUNK
+							 ? count - first
+							 : PHYSICS_BENCH_CHUNK,
+			};
+			physics_batch_sweep_and_move(
+				&bullet_aabb, &trajectories, from,
+				from + PHYSICS_BENCH_FRAME_TIME, &bodies,
+				&body_position_options, &body_direction_options,
+				&body_speed_options, physics_bench_on_collision);
+		}
+	}
+	const double sweep_ms = (GetTime() - start) * 1000.0 / PHYSICS_BENCH_FRAMES;
+
+	TraceLog(LOG_INFO,
+			 "bench: %zu bullets, %.3f ms a frame moving and colliding (%zu "
+			 "hits), %.3f ms a frame sweeping %d at a time (%zu hits)",
+			 count, legacy_ms, legacy_hits, sweep_ms, physics_sweep_lanes(),
+			 hits);
+
+	RL_FREE(legacy);
+	RL_FREE(fields);
+}
+
+void physics_bench_run()
+{
+	// the same bullets every run
+	srand(0);
+	physics_bench_count(1000);
+	physics_bench_count(10000);
+	physics_bench_count(100000);
+}
@@ -0,0 +1,10 @@
+#pragma once
+///
+/// Compares sweeping bullets with physics_batch_sweep_and_move against moving
+/// and colliding them every frame with physics_batch_collide_and_move, the way
+/// bullets used to work.
+///
+
+/// Time both ways with 1k, 10k and 100k bullets and log the results. Uses
+/// raylib's timer, so the window must be open.
+void physics_bench_run();
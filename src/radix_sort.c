@@ -0,0 +1,63 @@
+#include "radix_sort.h"
+#include <assert.h>
+#include <string.h>
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES (sizeof(uint64_t) * 8 / RADIX_BITS)
+
+void radix_sort(RadixSortItem* items, RadixSortItem* scratch, size_t count)
+{
+	// count every byte of every key in one go
+	size_t histograms[RADIX_PASSES][RADIX_BUCKETS];
+	memset(histograms, 0, sizeof(histograms));
+	for (size_t i = 0; i < count; ++i) {
+		const uint64_t key = items[i].key;
+		for (uint8_t pass = 0; pass < RADIX_PASSES; ++pass) {
+			++histograms[pass][(key >> (pass * RADIX_BITS)) &
+							   (RADIX_BUCKETS - 1)];
+		}
+	}
+
+	RadixSortItem* from = items;
+	RadixSortItem* to = scratch;
+	for (uint8_t pass = 0; pass < RADIX_PASSES; ++pass) {
+		size_t* histogram = histograms[pass];
+		const uint8_t shift = pass * RADIX_BITS;
+		// every key has the same byte here, this pass wouldn't move anything
+		if (count == 0 ||
+			histogram[(from[0].key >> shift) & (RADIX_BUCKETS - 1)] == count) {
+			continue;
+		}
+
+		// turn counts into the index each bucket starts at
+		size_t offset = 0;
+		for (size_t bucket = 0; bucket < RADIX_BUCKETS; ++bucket) {
+			const size_t bucket_count = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucket_count;
+		}
+
+		for (size_t i = 0; i < count; ++i) {
+			const size_t bucket = (from[i].key >> shift) & (RADIX_BUCKETS - 1);
+			to[histogram[bucket]++] = from[i];
+		}
+
+		RadixSortItem* swap = from;
+		from = to;
+		to = swap;
+	}
+
+	if (from != items) {
+		memcpy(items, from, count * sizeof(RadixSortItem));
+	}
+}
+
+uint32_t radix_sort_float_key(float value)
+{
+	// positive ieee floats order the same way as their bits do
+	assert(value >= 0);
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
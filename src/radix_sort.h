@@ -0,0 +1,21 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/// Something to be sorted by a 64 bit key. value is usually an index into
+/// whatever array the keys were made from.
+typedef struct
+{
+	uint64_t key;
+	uint32_t value;
+} RadixSortItem;
+
+/// Sort items by key, from low to high. Stable, so items with the same key
+/// keep their order. Bytes which are the same in every key are skipped, so
+/// keys which only use their low bits only pay for those.
+/// @param scratch: at least count items of memory to sort through, its
+/// contents afterwards are garbage
+void radix_sort(RadixSortItem* items, RadixSortItem* scratch, size_t count);
+
+/// Turn a float which is zero or greater into a key which sorts the same way.
+uint32_t radix_sort_float_key(float value);
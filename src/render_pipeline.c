@@ -1,107 +1,352 @@
 #include "render_pipeline.h"
+#include "constants/controls.h"
 #include "constants/screen.h"
+#include "dynamic_resolution.h"
 #include "gamestate.h"
+#include "gl_state.h"
+#include "gpu_timer.h"
+#include "render_queue.h"
+#include "scene_uniforms.h"
+#include "shader_cache.h"
+#include "staging.h"
+#include "terrain.h"
+#include <assert.h>
+#include <external/glad.h>
 #include <math.h>
 #include <raylib.h>
+#include <raymath.h>
 #include <rlgl.h>
 
 // useful for screen scaling
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
+/// A render texture the game is drawn into. Unlike LoadRenderTexture, depth is
+/// a texture so post processing can read it, and a second color attachment
+/// holds normals.
+typedef struct
+{
+	RenderTexture2D target;
+	/// octahedral encoded world space normals, two channels
+	Texture normals;
+} SceneTarget;
+
+/// How the views are laid out in the main target, row major from the top left.
+/// Cells past the number of views are left black.
+typedef struct
+{
+	uint8_t columns;
+	uint8_t rows;
+} ViewGrid;
+
+/// Where post.frag's uniforms are
+typedef struct
+{
+	int normal_texture;
+	int depth_texture;
+	int texel_size;
+	int view_size;
+} PostUniforms;
+
 // window scaling and splitscreen
+#if RENDER_DIRECT_VIEWPORTS
+/// every view is drawn straight into this, then window_draw post processes
+/// it onto the window
+static SceneTarget main_target;
+#else
+/// view i's target is as big as its cell gets in any grid with more than i
+/// views, so only the first one is full size. loaded by
+/// load_view_targets as the view count goes up
+static SceneTarget view_targets[MAX_VIEWS];
+/// how many of view_targets are loaded
+static uint8_t view_targets_loaded;
+/// view_targets after post processing, laid out in a grid
 static RenderTexture2D main_target;
-static RenderTexture2D rt1;
-static RenderTexture2D rt2;
-static Texture normals;
-static Texture depth;
-static Shader shader;
+#endif
+static Shader post_shader;
+static PostUniforms post_uniforms;
 static Shader gather_shader;
+static RenderTimings timings;
+static uint8_t view_count = NUM_PLANES;
+/// layout of the views drawn last frame
+static ViewGrid grid = {.columns = 1, .rows = 1};
+/// whether overlay_draw runs, toggled with DEBUG_OVERLAY_KEY
+static bool show_overlay;
+/// part of main_target actually drawn to this frame, starting from the bottom
+/// left. less than the whole thing when dynamic resolution has scaled down
+static int rendered_width = GAME_WIDTH;
+static int rendered_height = GAME_HEIGHT;
 
-// make sure to take absolute values when using height...
-static const Rectangle splitScreenRect = {
-	.x = 0,
-	.y = 0,
-	.width = GAME_WIDTH,
-	.height = -(GAME_HEIGHT / 2.0f),
-};
+/// the view's clip space is the whole viewport
+static const Vector4 full_viewport_transform = {1, 1, 0, 0};
 
 static void init_rendertextures();
+/// The smallest grid with room for count views. The game is taller than it
+/// is wide, so views stack before they go side by side.
+static ViewGrid view_grid_for(uint8_t count);
+#if !RENDER_DIRECT_VIEWPORTS
+/// Make sure the first count view_targets are loaded.
+static void load_view_targets(uint8_t count);
+#endif
 static void window_draw(float screen_scale);
+/// Draw CPU and GPU timings, and how much terrain each view drew, in the top
+/// left of the window.
+static void overlay_draw();
+/// Log the same things the overlay shows, plus render queue, GL state and
+/// staging counters.
+static void render_log_profile();
+static SceneTarget load_scene_target(int width, int height);
+static void unload_scene_target(SceneTarget* scene);
+/// Start drawing a scene target's color with every post processing effect
+/// applied. views_size is how much of it is drawn to, from the bottom left.
+/// Finish with EndShaderMode.
+static void begin_post_processing(const SceneTarget* scene, int view_width,
+								  int view_height);
+
+/// Like BeginMode3D, but only draws to part of the current render texture.
+/// The projection uses the view's aspect instead of the render texture's.
+/// Clears the area first. x and y are in framebuffer coordinates, so y = 0 is
+/// the bottom.
+static void begin_view_mode(const RenderView* view, int x, int y, int width,
+							int height);
+/// Counterpart to begin_view_mode.
+static void end_view_mode();
+#if RENDER_SINGLE_PASS_VIEWS
+/// RenderView.viewport_transform which puts a view in its cell of the grid,
+/// for drawing every view into one viewport.
+static Vector4 view_grid_transform(const ViewGrid* layout, uint8_t index);
+/// Set up to draw into all views at once: the viewport covers the whole
+/// render texture and each view's clip planes keep it inside its own part.
+static void begin_shared_views_mode(int width, int height);
+/// Counterpart to begin_shared_views_mode.
+static void end_shared_views_mode();
+#endif
 
-void render(void (*game_draw)())
+void render(void (*game_prepare)(), void (*game_draw)(const RenderView* view),
+			void (*game_draw_views)(const RenderView* views,
+									uint8_t view_count))
 {
-	// Render Camera 1
-	BeginTextureMode(rt1);
-	// clang-format off
-		ClearBackground(RAYWHITE);
-        const FullCamera *player_one = &gamestate_get_cameras()[0];
-        BeginMode3D(player_one->camera);
-            // draw in-game objects
+	grid = view_grid_for(view_count);
+	const float cell_width = (float)GAME_WIDTH / (float)grid.columns;
+	const float cell_height = (float)GAME_HEIGHT / (float)grid.rows;
+	const FullCamera* cameras = gamestate_get_cameras();
+	RenderView views[MAX_VIEWS];
+	for (uint8_t i = 0; i < view_count; ++i) {
+		views[i] = (RenderView){
+			.index = i,
+			.plane = i % NUM_PLANES,
+			.camera = &cameras[i],
+			.aspect = cell_width / cell_height,
+			.viewport_transform = full_viewport_transform,
+		};
+	}
+
+	gpu_timer_begin_frame();
+	double start = GetTime();
+	game_prepare();
+	timings.prepare_ms = (GetTime() - start) * 1000.0;
+
+	// views are drawn into the bottom left of their render targets at the
+	// current scale, and window_draw stretches them back out
+	dynamic_resolution_update(GetFrameTime());
+	const float resolution_scale = dynamic_resolution_get_scale();
+	const int view_width = (int)(cell_width * resolution_scale);
+	const int view_height = (int)(cell_height * resolution_scale);
+	rendered_width = view_width * grid.columns;
+	rendered_height = view_height * grid.rows;
+
+#if RENDER_DIRECT_VIEWPORTS
+	// every view goes straight into its cell of the main target
+	BeginTextureMode(main_target.target);
+	if (view_count < grid.columns * grid.rows) {
+		// nothing else draws over the empty cells
+		ClearBackground(BLACK);
+	}
+	for (uint8_t i = 0; i < view_count; ++i) {
+		const RenderView* view = &views[i];
+		// the top row is the highest in framebuffer coordinates
+		const int x = (i % grid.columns) * view_width;
+		const int y = (grid.rows - 1 - (i / grid.columns)) * view_height;
+		// clang-format off
+		begin_view_mode(view, x, y, view_width, view_height);
 	        BeginShaderMode(gather_shader);
-            game_draw();
+            start = GetTime();
+            gpu_timer_begin(GPU_TIMER_VIEW + i);
+            scene_uniforms_set_views(view, 1);
+            render_queue_begin(view, 1);
+            game_draw(view);
+#if !RENDER_SINGLE_PASS_VIEWS
+            game_draw_views(view, 1);
+#endif
+            render_queue_flush();
+            gpu_timer_end(GPU_TIMER_VIEW + i);
+            timings.view_ms[i] = (GetTime() - start) * 1000.0;
             EndShaderMode();
+		end_view_mode();
+		// clang-format on
+	}
 
-        EndMode3D();
-	// clang-format on
+#if RENDER_SINGLE_PASS_VIEWS
+	// the same views again, but squeezed into their cells of one viewport
+	// covering the whole target
+	RenderView shared_views[MAX_VIEWS];
+	for (uint8_t i = 0; i < view_count; ++i) {
+		shared_views[i] = views[i];
+		shared_views[i].viewport_transform = view_grid_transform(&grid, i);
+	}
+	start = GetTime();
+	begin_shared_views_mode(rendered_width, rendered_height);
+	gpu_timer_begin(GPU_TIMER_SHARED_VIEWS);
+	scene_uniforms_set_views(shared_views, view_count);
+	render_queue_begin(shared_views, view_count);
+	game_draw_views(shared_views, view_count);
+	render_queue_flush();
+	gpu_timer_end(GPU_TIMER_SHARED_VIEWS);
+	end_shared_views_mode();
+	timings.shared_ms = (GetTime() - start) * 1000.0;
+#endif
 	EndTextureMode();
-
-	// Render Camera 2
-	BeginTextureMode(rt2);
-	// clang-format off
-		ClearBackground(RAYWHITE);
-        const FullCamera *player_two = &gamestate_get_cameras()[1];
-        BeginMode3D(player_two->camera);
+#else
+	for (uint8_t i = 0; i < view_count; ++i) {
+		const RenderView* view = &views[i];
+		BeginTextureMode(view_targets[i].target);
+		// clang-format off
+		begin_view_mode(view, 0, 0, view_width, view_height);
             // draw in-game objects
-            game_draw();
-
-        EndMode3D();
-	// clang-format on
-	EndTextureMode();
+	        BeginShaderMode(gather_shader);
+            start = GetTime();
+            gpu_timer_begin(GPU_TIMER_VIEW + i);
+            scene_uniforms_set_views(view, 1);
+            render_queue_begin(view, 1);
+            game_draw(view);
+            game_draw_views(view, 1);
+            render_queue_flush();
+            gpu_timer_end(GPU_TIMER_VIEW + i);
+            timings.view_ms[i] = (GetTime() - start) * 1000.0;
+            EndShaderMode();
+		end_view_mode();
+		// clang-format on
+		EndTextureMode();
+	}
 
 	// set draw target to the rendertexture, dont actually draw to window
 	BeginTextureMode(main_target);
 	ClearBackground(BLACK);
-	DrawTextureRec(rt1.texture, splitScreenRect, (Vector2){0, 0}, WHITE);
-	DrawTextureRec(rt2.texture, splitScreenRect,
-				   (Vector2){
-					   0,
-					   fabsf(splitScreenRect.height),
-				   },
-				   WHITE);
+	// in the bottom left of each view target
+	const Rectangle view_rect = {
+		.x = 0,
+		.y = 0,
+		.width = (float)view_width,
+		.height = -(float)view_height,
+	};
+	// post processing happens on the way, one pass for each view. they are
+	// laid out in the bottom left, where window_draw expects them
+	gpu_timer_begin(GPU_TIMER_WINDOW);
+	for (uint8_t i = 0; i < view_count; ++i) {
+		begin_post_processing(&view_targets[i], view_width, view_height);
+		DrawTextureRec(view_targets[i].target.texture, view_rect,
+					   (Vector2){
+						   (float)((i % grid.columns) * view_width),
+						   (float)(GAME_HEIGHT - rendered_height +
+								   ((i / grid.columns) * view_height)),
+					   },
+					   WHITE);
+		EndShaderMode();
+	}
+	gpu_timer_end(GPU_TIMER_WINDOW);
 	EndTextureMode();
+#endif
+
+	render_queue_end_frame();
+	gl_state_end_frame();
+	staging_fence();
+
+	if (IsKeyPressed(DEBUG_OVERLAY_KEY)) {
+		show_overlay = !show_overlay;
+	}
+	if (IsKeyPressed(PROFILE_DUMP_KEY)) {
+		render_log_profile();
+	}
 
 	// draw the game to the window at the correct size
 	BeginDrawing();
+	gpu_timer_begin(GPU_TIMER_WINDOW);
 	window_draw(gamestate_get_screen_scale());
+	gpu_timer_end(GPU_TIMER_WINDOW);
+	if (show_overlay) {
+		overlay_draw();
+	}
 	EndDrawing();
 }
 
+RenderTimings render_get_timings() { return timings; }
+
+void render_set_view_count(uint8_t count)
+{
+	assert(count > 0 && count <= MAX_VIEWS);
+	view_count = count;
+#if !RENDER_DIRECT_VIEWPORTS
+	load_view_targets(count);
+#endif
+}
+
+uint8_t render_get_view_count() { return view_count; }
+
+Matrix render_view_get_view_projection(const RenderView* view)
+{
+	const Camera3D* camera = &view->camera->camera;
+	// same as what BeginMode3D does for perspective cameras
+	const Matrix view_matrix =
+		MatrixLookAt(camera->position, camera->target, camera->up);
+	const Matrix projection =
+		MatrixPerspective(camera->fovy * DEG2RAD, view->aspect,
+						  RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR);
+	return MatrixMultiply(view_matrix, projection);
+}
+
 void render_pipeline_init()
 {
 	init_rendertextures();
-	shader = LoadShader(0, "assets/postprocessing/edges.frag");
-	gather_shader = LoadShader("assets/postprocessing/gather.vert",
-							   "assets/postprocessing/gather.frag");
+	dynamic_resolution_init();
+	scene_uniforms_init();
+	gpu_timer_init();
+	staging_init();
+	post_shader = shader_cache_load(0, "assets/postprocessing/post.frag");
+	gather_shader = shader_cache_load("assets/postprocessing/gather.vert",
+									  "assets/postprocessing/gather.frag");
 
-	// add additional textures to rt1
-	rlFramebufferAttach(rt1.id, rt1.texture.id, 0, RL_ATTACHMENT_TEXTURE2D, 0);
-	rlFramebufferAttach(rt1.id, normals.id, 1, RL_ATTACHMENT_TEXTURE2D, 0);
-	rlFramebufferAttach(rt1.id, depth.id, 2, RL_ATTACHMENT_TEXTURE2D, 0);
-
-	int resolution = GetShaderLocation(shader, "resolution");
-	float resolution_vec2[2] = {GAME_WIDTH, GAME_HEIGHT};
-	SetShaderValue(shader, resolution, resolution_vec2, SHADER_UNIFORM_VEC2);
+	post_uniforms = (PostUniforms){
+		.normal_texture = GetShaderLocation(post_shader, "normalTexture"),
+		.depth_texture = GetShaderLocation(post_shader, "depthTexture"),
+		.texel_size = GetShaderLocation(post_shader, "texelSize"),
+		.view_size = GetShaderLocation(post_shader, "viewSize"),
+	};
+	// to undo the perspective projection's depth
+	const float near = RL_CULL_DISTANCE_NEAR;
+	const float far = RL_CULL_DISTANCE_FAR;
+	SetShaderValue(post_shader, GetShaderLocation(post_shader, "near"), &near,
+				   SHADER_UNIFORM_FLOAT);
+	SetShaderValue(post_shader, GetShaderLocation(post_shader, "far"), &far,
+				   SHADER_UNIFORM_FLOAT);
 }
 
 void render_pipeline_cleanup()
 {
-	UnloadShader(shader);
-	UnloadRenderTexture(rt1);
-	UnloadRenderTexture(rt2);
-	rlUnloadTexture(normals.id);
-	rlUnloadTexture(depth.id);
+	render_log_profile();
+	gpu_timer_cleanup();
+	staging_cleanup();
+	UnloadShader(post_shader);
+	UnloadShader(gather_shader);
+	scene_uniforms_cleanup();
+#if RENDER_DIRECT_VIEWPORTS
+	unload_scene_target(&main_target);
+#else
+	for (uint8_t i = 0; i < view_targets_loaded; ++i) {
+		unload_scene_target(&view_targets[i]);
+	}
+	view_targets_loaded = 0;
 	UnloadRenderTexture(main_target);
+#endif
 }
 
 ///
@@ -120,45 +365,241 @@ void render_pipeline_gather_screen_info()
 static void init_rendertextures()
 {
 	// variable width screen
+#if RENDER_DIRECT_VIEWPORTS
+	main_target = load_scene_target(GAME_WIDTH, GAME_HEIGHT);
+	SetTextureFilter(main_target.target.texture, TEXTURE_FILTER_BILINEAR);
+#else
 	main_target = LoadRenderTexture(GAME_WIDTH, GAME_HEIGHT);
-	int h = abs((int)splitScreenRect.height);
-	int w = abs((int)splitScreenRect.width);
-	rt1 = LoadRenderTexture(w, h);
-	rt2 = LoadRenderTexture(w, h);
-	normals = (Texture){0};
-	depth = (Texture){0};
-	normals.height = h;
-	normals.width = w;
-	normals.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
-	normals.mipmaps = 1;
-	normals.id = rlLoadTexture(NULL, normals.width, normals.height,
-							   normals.format, normals.mipmaps);
-	depth.height = h;
-	depth.width = w;
-	depth.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
-	depth.mipmaps = 1;
-	depth.id = rlLoadTexture(NULL, depth.width, depth.height, depth.format,
-							 depth.mipmaps);
 
 	// set all to bilinear
 	SetTextureFilter(main_target.texture, TEXTURE_FILTER_BILINEAR);
-	SetTextureFilter(rt1.texture, TEXTURE_FILTER_BILINEAR);
-	SetTextureFilter(rt2.texture, TEXTURE_FILTER_BILINEAR);
+	load_view_targets(view_count);
+#endif
+}
+
+#if !RENDER_DIRECT_VIEWPORTS
+static void load_view_targets(uint8_t count)
+{
+	for (uint8_t i = view_targets_loaded; i < count; ++i) {
+		// the biggest cell view i is ever drawn into, at full resolution
+		int width = 0;
+		int height = 0;
+		for (uint8_t views = i + 1; views <= MAX_VIEWS; ++views) {
+			const ViewGrid layout = view_grid_for(views);
+			const int cell_width =
+				(GAME_WIDTH + layout.columns - 1) / layout.columns;
+			const int cell_height =
+				(GAME_HEIGHT + layout.rows - 1) / layout.rows;
+			width = MAX(width, cell_width);
+			height = MAX(height, cell_height);
+		}
+		view_targets[i] = load_scene_target(width, height);
+		SetTextureFilter(view_targets[i].target.texture,
+						 TEXTURE_FILTER_BILINEAR);
+	}
+	view_targets_loaded = MAX(view_targets_loaded, count);
+}
+#endif
+
+static ViewGrid view_grid_for(uint8_t count)
+{
+	uint8_t rows = 1;
+	while (rows * rows < count) {
+		++rows;
+	}
+	return (ViewGrid){
+		.columns = (count + rows - 1) / rows,
+		.rows = rows,
+	};
+}
+
+#if RENDER_SINGLE_PASS_VIEWS
+static Vector4 view_grid_transform(const ViewGrid* layout, uint8_t index)
+{
+	const float columns = layout->columns;
+	const float rows = layout->rows;
+	const float column = (float)(index % layout->columns);
+	const float row = (float)(index / layout->columns);
+	// centers of the cells in normalized device coordinates, the top row is
+	// at the top
+	return (Vector4){
+		1.0f / columns,
+		1.0f / rows,
+		-1.0f + (((2.0f * column) + 1.0f) / columns),
+		1.0f - (((2.0f * row) + 1.0f) / rows),
+	};
+}
+#endif
+
+static SceneTarget load_scene_target(int width, int height)
+{
+	SceneTarget scene = {0};
+	RenderTexture2D* target = &scene.target;
+	target->id = rlLoadFramebuffer(width, height);
+	rlEnableFramebuffer(target->id);
+
+	target->texture = (Texture){
+		.width = width,
+		.height = height,
+		.mipmaps = 1,
+		.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+	};
+	target->texture.id =
+		rlLoadTexture(NULL, width, height, target->texture.format, 1);
+
+	// raylib has no two channel format which samples as .rg, make it directly
+	scene.normals = (Texture){
+		.width = width,
+		.height = height,
+		.mipmaps = 1,
+		.format = PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA,
+	};
+	glGenTextures(1, &scene.normals.id);
+	glBindTexture(GL_TEXTURE_2D, scene.normals.id);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, width, height, 0, GL_RG,
+				 GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	target->depth = (Texture){
+		.width = width,
+		.height = height,
+		.mipmaps = 1,
+		// raylib's own placeholder format for depth textures
+		.format = 19,
+	};
+	target->depth.id = rlLoadTextureDepth(width, height, false);
+
+	rlFramebufferAttach(target->id, target->texture.id,
+						RL_ATTACHMENT_COLOR_CHANNEL0, RL_ATTACHMENT_TEXTURE2D,
+						0);
+	rlFramebufferAttach(target->id, scene.normals.id,
+						RL_ATTACHMENT_COLOR_CHANNEL1, RL_ATTACHMENT_TEXTURE2D,
+						0);
+	rlFramebufferAttach(target->id, target->depth.id, RL_ATTACHMENT_DEPTH,
+						RL_ATTACHMENT_TEXTURE2D, 0);
+	if (!rlFramebufferComplete(target->id)) {
+		TraceLog(LOG_FATAL, "render: scene framebuffer %d is incomplete",
+				 target->id);
+	}
+	// which attachments are drawn to is framebuffer state, so this only needs
+	// doing once. every shader drawing to a scene writes normals to location 1
+	rlEnableFramebuffer(target->id);
+	rlActiveDrawBuffers(2);
+	rlDisableFramebuffer();
+	return scene;
+}
+
+static void unload_scene_target(SceneTarget* scene)
+{
+	rlUnloadTexture(scene->normals.id);
+	// also deletes the depth texture
+	UnloadRenderTexture(scene->target);
+	*scene = (SceneTarget){0};
+}
+
+static void begin_post_processing(const SceneTarget* scene, int view_width,
+								  int view_height)
+{
+	BeginShaderMode(post_shader);
+	const float width = (float)scene->target.texture.width;
+	const float height = (float)scene->target.texture.height;
+	const float texel_size[2] = {1.0f / width, 1.0f / height};
+	const float view_size[2] = {(float)view_width / width,
+								(float)view_height / height};
+	SetShaderValue(post_shader, post_uniforms.texel_size, texel_size,
+				   SHADER_UNIFORM_VEC2);
+	SetShaderValue(post_shader, post_uniforms.view_size, view_size,
+				   SHADER_UNIFORM_VEC2);
+	SetShaderValueTexture(post_shader, post_uniforms.normal_texture,
+						  scene->normals);
+	SetShaderValueTexture(post_shader, post_uniforms.depth_texture,
+						  scene->target.depth);
+}
+
+static void begin_view_mode(const RenderView* view, int x, int y, int width,
+							int height)
+{
+	// anything batched so far belongs to the previous viewport
+	rlDrawRenderBatchActive();
+	rlViewport(x, y, width, height);
+	rlScissor(x, y, width, height);
+	rlEnableScissorTest();
+	// the scissor keeps this from clearing the other view
+	ClearBackground(RAYWHITE);
+
+	// same as BeginMode3D for perspective cameras
+	const Camera3D* camera = &view->camera->camera;
+	rlMatrixMode(RL_PROJECTION);
+	rlPushMatrix();
+	rlLoadIdentity();
+	const double top = RL_CULL_DISTANCE_NEAR * tan(camera->fovy * 0.5 * DEG2RAD);
+	const double right = top * view->aspect;
+	rlFrustum(-right, right, -top, top, RL_CULL_DISTANCE_NEAR,
+			  RL_CULL_DISTANCE_FAR);
+	rlMatrixMode(RL_MODELVIEW);
+	rlLoadIdentity();
+	const Matrix view_matrix =
+		MatrixLookAt(camera->position, camera->target, camera->up);
+	rlMultMatrixf(MatrixToFloat(view_matrix));
+	rlEnableDepthTest();
+}
+
+static void end_view_mode()
+{
+	// flushes the batch while the scissor is still on
+	EndMode3D();
+	rlDisableScissorTest();
 }
 
+#if RENDER_SINGLE_PASS_VIEWS
+static void begin_shared_views_mode(int width, int height)
+{
+	rlDrawRenderBatchActive();
+	rlViewport(0, 0, width, height);
+	rlEnableDepthTest();
+	// left, right, bottom, and top of each view's clip space
+	glEnable(GL_CLIP_DISTANCE0);
+	glEnable(GL_CLIP_DISTANCE1);
+	glEnable(GL_CLIP_DISTANCE2);
+	glEnable(GL_CLIP_DISTANCE3);
+}
+
+static void end_shared_views_mode()
+{
+	glDisable(GL_CLIP_DISTANCE0);
+	glDisable(GL_CLIP_DISTANCE1);
+	glDisable(GL_CLIP_DISTANCE2);
+	glDisable(GL_CLIP_DISTANCE3);
+	rlDisableDepthTest();
+}
+#endif
+
 /// Resize the game's main render texture and draw it to the window.
 static void window_draw(float screen_scale)
 {
 	// color of the bars around the rendertexture
 	ClearBackground(BLACK);
-	// draw the render texture scaled
+	// draw the render texture scaled. this also upscales whatever part of it
+	// dynamic resolution left the game drawn into
+#if RENDER_DIRECT_VIEWPORTS
+	// and post processes it on the way, for every view at once
+	begin_post_processing(&main_target, rendered_width / grid.columns,
+						  rendered_height / grid.rows);
+	const Texture2D game_texture = main_target.target.texture;
+#else
+	const Texture2D game_texture = main_target.texture;
+#endif
 	DrawTexturePro(
-		main_target.texture,
+		game_texture,
 		(Rectangle){
 			0.0f,
 			0.0f,
-			(float)main_target.texture.width,
-			(float)-main_target.texture.height,
+			(float)rendered_width,
+			(float)-rendered_height,
 		},
 		(Rectangle){
 			((float)GetScreenWidth() - ((float)GAME_WIDTH * screen_scale)) *
@@ -169,4 +610,92 @@ static void window_draw(float screen_scale)
 			(float)GAME_HEIGHT * screen_scale,
 		},
 		(Vector2){0, 0}, 0.0f, WHITE);
+#if RENDER_DIRECT_VIEWPORTS
+	EndShaderMode();
+#endif
+}
+
+static void overlay_draw()
+{
+#define OVERLAY_FONT_SIZE 10
+#define OVERLAY_LINE_HEIGHT 12
+	int y = OVERLAY_LINE_HEIGHT;
+	DrawText(TextFormat("%d fps, %.0f%% resolution", GetFPS(),
+						dynamic_resolution_get_scale() * 100.0f),
+			 OVERLAY_LINE_HEIGHT, y, OVERLAY_FONT_SIZE, GREEN);
+	y += OVERLAY_LINE_HEIGHT;
+	DrawText(TextFormat("cpu prepare %.2f ms", timings.prepare_ms),
+			 OVERLAY_LINE_HEIGHT, y, OVERLAY_FONT_SIZE, GREEN);
+	y += OVERLAY_LINE_HEIGHT;
+	for (uint8_t i = 0; i < view_count; ++i) {
+		DrawText(TextFormat("cpu view %d %.2f ms", i + 1, timings.view_ms[i]),
+				 OVERLAY_LINE_HEIGHT, y, OVERLAY_FONT_SIZE, GREEN);
+		y += OVERLAY_LINE_HEIGHT;
+	}
+	for (uint8_t i = 0; i < view_count; ++i) {
+		const TerrainDrawStats terrain = terrain_get_draw_stats(i);
+		DrawText(TextFormat("terrain view %d %zu drawn, %zu culled, %zu "
+							"occluded",
+							i + 1, terrain.drawn, terrain.culled,
+							terrain.occluded),
+				 OVERLAY_LINE_HEIGHT, y, OVERLAY_FONT_SIZE, GREEN);
+		y += OVERLAY_LINE_HEIGHT;
+	}
+#if RENDER_SINGLE_PASS_VIEWS
+	DrawText(TextFormat("cpu shared views %.2f ms", timings.shared_ms),
+			 OVERLAY_LINE_HEIGHT, y, OVERLAY_FONT_SIZE, GREEN);
+	y += OVERLAY_LINE_HEIGHT;
+#endif
+	if (!gpu_timer_is_supported()) {
+		return;
+	}
+	for (uint8_t i = 0; i < GPU_TIMER_COUNT; ++i) {
+		DrawText(TextFormat("gpu %s %.2f ms", gpu_timer_get_name(i),
+							gpu_timer_get_average_ms(i)),
+				 OVERLAY_LINE_HEIGHT, y, OVERLAY_FONT_SIZE, YELLOW);
+		y += OVERLAY_LINE_HEIGHT;
+	}
+#undef OVERLAY_FONT_SIZE
+#undef OVERLAY_LINE_HEIGHT
+}
+
+static void render_log_profile()
+{
+	TraceLog(LOG_INFO, "profile: %d fps, %.0f%% resolution", GetFPS(),
+			 dynamic_resolution_get_scale() * 100.0f);
+	TraceLog(LOG_INFO, "profile: cpu prepare %.2f ms", timings.prepare_ms);
+	for (uint8_t i = 0; i < view_count; ++i) {
+		TraceLog(LOG_INFO, "profile: cpu view %d %.2f ms", i + 1,
+				 timings.view_ms[i]);
+	}
+#if RENDER_SINGLE_PASS_VIEWS
+	TraceLog(LOG_INFO, "profile: cpu shared views %.2f ms",
+			 timings.shared_ms);
+#endif
+	for (uint8_t i = 0; i < view_count; ++i) {
+		const TerrainDrawStats terrain = terrain_get_draw_stats(i);
+		TraceLog(LOG_INFO,
+				 "profile: terrain view %d %zu chunks drawn, %zu culled, %zu "
+				 "occluded, %zu triangles (%zu facing away), %.2f ms culling",
+				 i + 1, terrain.drawn, terrain.culled, terrain.occluded,
+				 terrain.triangles, terrain.backface_triangles,
+				 terrain.cull_ms);
+	}
+	for (uint8_t i = 0; i < GPU_TIMER_COUNT; ++i) {
+		TraceLog(LOG_INFO, "profile: gpu %s %.2f ms average",
+				 gpu_timer_get_name(i), gpu_timer_get_average_ms(i));
+	}
+	const RenderQueueStats queue = render_queue_get_stats();
+	TraceLog(LOG_INFO,
+			 "profile: %zu render commands, %zu shader binds, %zu vao binds",
+			 queue.commands, queue.shader_binds, queue.vao_binds);
+	const GlStateStats gl = gl_state_get_stats();
+	TraceLog(LOG_INFO, "profile: %zu gl calls made, %zu avoided",
+			 gl.calls_made, gl.calls_avoided);
+	const StagingStats staging = staging_get_stats();
+	TraceLog(LOG_INFO,
+			 "profile: %zu staging copies (%zu bytes), %zu times full, %zu "
+			 "waits",
+			 staging.copies, staging.bytes_copied, staging.full,
+			 staging.waits);
 }
@@ -1,6 +1,59 @@
 #pragma once
+#include "camera.h"
+#include "constants/screen.h"
+#include <raylib.h>
+#include <stdint.h>
+
+/// Everything a draw function needs to know about the split-screen view it is
+/// currently drawing.
+typedef struct
+{
+	/// which view this is, less than MAX_VIEWS
+	uint8_t index;
+	/// the plane this view follows, less than NUM_PLANES. views past the
+	/// players' own spectate plane index % NUM_PLANES
+	uint8_t plane;
+	const FullCamera* camera;
+	/// width / height of the area the view is rendered into
+	float aspect;
+	/// where the view's clip space lands in the current viewport, as an xy
+	/// scale then a zw offset in normalized device coordinates. {1, 1, 0, 0}
+	/// unless several views are being drawn into one viewport at once
+	Vector4 viewport_transform;
+} RenderView;
+
+
+/// CPU time spent in each part of the last frame's render, in milliseconds.
+typedef struct
+{
+	/// game_prepare, the camera-independent work done once for all views
+	double prepare_ms;
+	/// game_draw for each view, plus game_draw_views when views are drawn one
+	/// at a time. only the first render_get_view_count are meaningful
+	double view_ms[MAX_VIEWS];
+	/// game_draw_views when all views are drawn in one pass, otherwise 0
+	double shared_ms;
+} RenderTimings;
 
 void render_pipeline_gather_screen_info();
 void render_pipeline_init();
-void render(void (*game_draw)());
+/// Draw a frame. game_prepare is called once with work every view shares, then
+/// game_draw is called once for each view. game_draw_views draws things which
+/// support multiple views per draw call, see scene_uniforms_set_views. It gets
+/// all views at once if RENDER_SINGLE_PASS_VIEWS is on, otherwise it is
+/// called with one view at a time, right after game_draw. Both can push to the
+/// render queue, which is sorted and drawn once they return.
+void render(void (*game_prepare)(), void (*game_draw)(const RenderView* view),
+			void (*game_draw_views)(const RenderView* views,
+									uint8_t view_count));
+RenderTimings render_get_timings();
+/// Change how many views are drawn, starting next frame. The first NUM_PLANES
+/// views are the players', any past those are spectators.
+/// @param count: number between 1 and MAX_VIEWS
+void render_set_view_count(uint8_t count);
+uint8_t render_get_view_count();
 void render_pipeline_cleanup();
+
+/// The view and projection matrices which BeginMode3D uses for this view,
+/// multiplied together. Useful for culling.
+Matrix render_view_get_view_projection(const RenderView* view);
@@ -0,0 +1,121 @@
+#include "render_queue.h"
+#include "gl_state.h"
+#include "radix_sort.h"
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <raymath.h>
+#include <rlgl.h>
+
+// key layout, from most to least significant bits: pass, shader, texture,
+// depth. GL names past what fits only sort a little worse
+#define KEY_PASS_SHIFT 60
+#define KEY_SHADER_SHIFT 48
+#define KEY_SHADER_MASK 0xFFFu
+#define KEY_TEXTURE_SHIFT 32
+#define KEY_TEXTURE_MASK 0xFFFFu
+
+static RenderCommand commands[RENDER_QUEUE_CAPACITY];
+static RadixSortItem sort_items[RENDER_QUEUE_CAPACITY];
+static RadixSortItem sort_scratch[RENDER_QUEUE_CAPACITY];
+static size_t command_count;
+static const RenderView* queued_views;
+static uint8_t queued_view_count;
+static RenderQueueStats frame_stats;
+static RenderQueueStats last_frame_stats;
+
+static uint64_t render_queue_key(const RenderCommand* command);
+
+void render_queue_begin(const RenderView* views, uint8_t view_count)
+{
+	assert(command_count == 0);
+	queued_views = views;
+	queued_view_count = view_count;
+}
+
+void render_queue_push(const RenderCommand* command)
+{
+	assert(command->pass < RENDER_PASS_COUNT);
+	assert(command->draw);
+	if (command_count >= RENDER_QUEUE_CAPACITY) {
+		TraceLog(LOG_WARNING, "Render queue is full, drawing immediately");
+		command->draw(command->data);
+		return;
+	}
+	commands[command_count++] = *command;
+}
+
+float render_queue_distance(Vector3 point)
+{
+	float nearest = FLT_MAX;
+	for (uint8_t i = 0; i < queued_view_count; ++i) {
+		nearest = fminf(
+			nearest,
+			Vector3Distance(point, queued_views[i].camera->camera.position));
+	}
+	return nearest;
+}
+
+void render_queue_flush()
+{
+	if (command_count == 0) {
+		queued_views = NULL;
+		queued_view_count = 0;
+		return;
+	}
+	for (size_t i = 0; i < command_count; ++i) {
+		sort_items[i] = (RadixSortItem){
+			.key = render_queue_key(&commands[i]),
+			.value = (uint32_t)i,
+		};
+	}
+	radix_sort(sort_items, sort_scratch, command_count);
+
+	// nothing is left in raylib's batch to be drawn in the middle of a
+	// command, and the cache starts from nothing
+	rlDrawRenderBatchActive();
+	gl_state_invalidate();
+
+	// the state left bound from before the queue is unknown, so the first
+	// command always counts as a bind
+	uint32_t shader = 0;
+	uint32_t vao = 0;
+	for (size_t i = 0; i < command_count; ++i) {
+		const RenderCommand* command = &commands[sort_items[i].value];
+		if (i == 0 || command->shader != shader) {
+			++frame_stats.shader_binds;
+			shader = command->shader;
+		}
+		if (i == 0 || command->vao != vao) {
+			++frame_stats.vao_binds;
+			vao = command->vao;
+		}
+		command->draw(command->data);
+		if (!command->tracks_gl_state) {
+			gl_state_invalidate();
+		}
+	}
+	frame_stats.commands += command_count;
+	gl_state_reset();
+
+	command_count = 0;
+	queued_views = NULL;
+	queued_view_count = 0;
+}
+
+void render_queue_end_frame()
+{
+	last_frame_stats = frame_stats;
+	frame_stats = (RenderQueueStats){0};
+}
+
+RenderQueueStats render_queue_get_stats() { return last_frame_stats; }
+
+static uint64_t render_queue_key(const RenderCommand* command)
+{
+	return ((uint64_t)command->pass << KEY_PASS_SHIFT) |
+		   ((uint64_t)(command->shader & KEY_SHADER_MASK) << KEY_SHADER_SHIFT) |
+		   ((uint64_t)(command->texture & KEY_TEXTURE_MASK)
+			<< KEY_TEXTURE_SHIFT) |
+		   radix_sort_float_key(fmaxf(command->depth, 0));
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "render_pipeline.h"
+#include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Most commands which can be queued between render_queue_begin and
+/// render_queue_flush.
+#define RENDER_QUEUE_CAPACITY 64
+
+/// Groups of commands, drawn in this order.
+typedef enum
+{
+	/// solid geometry, front to back so hidden fragments fail the depth test
+	/// before shading
+	RENDER_PASS_OPAQUE = 0,
+	/// scenery past everything in the opaque pass, mostly hidden by it
+	RENDER_PASS_DISTANT,
+	/// the skybox, which only fills whatever nothing else covered
+	RENDER_PASS_SKY,
+	RENDER_PASS_COUNT,
+} RenderPass;
+
+/// Issues the draw calls for one command.
+/// @param data: the data pointer the command was queued with
+typedef void (*RenderQueueDraw)(const void* data);
+
+/// One draw to be sorted with the others. The GL object names are only used
+/// to order commands and count state changes, draw is what binds them.
+typedef struct
+{
+	RenderPass pass;
+	/// shader program the command draws with
+	uint32_t shader;
+	/// main texture the command draws with, 0 for none
+	uint32_t texture;
+	/// vertex array the command draws from
+	uint32_t vao;
+	/// distance to the nearest view being drawn, see render_queue_distance
+	float depth;
+	/// true if draw binds everything through gl_state. Otherwise the queue
+	/// assumes draw changed GL state behind the cache's back, like anything
+	/// drawn with raylib does
+	bool tracks_gl_state;
+	RenderQueueDraw draw;
+	/// must stay valid until render_queue_flush
+	const void* data;
+} RenderCommand;
+
+/// How many commands were drawn during the last frame, and how many times
+/// consecutive commands needed a different shader or vertex array.
+typedef struct
+{
+	size_t commands;
+	size_t shader_binds;
+	size_t vao_binds;
+} RenderQueueStats;
+
+/// Start queueing commands for some views. The views must stay valid until
+/// render_queue_flush.
+void render_queue_begin(const RenderView* views, uint8_t view_count);
+
+/// Add a command to the queue. It is drawn by the next render_queue_flush.
+void render_queue_push(const RenderCommand* command);
+
+/// Distance from a point to the nearest camera of the views being queued for.
+float render_queue_distance(Vector3 point);
+
+/// Sort the queued commands by pass, then shader, then texture, then depth,
+/// and draw them all. Empties the queue. raylib's batch is drawn first, and GL
+/// bindings are reset for raylib afterwards, see gl_state_reset.
+void render_queue_flush();
+
+/// Call once all of a frame's commands are flushed, to start counting the next
+/// frame's stats.
+void render_queue_end_frame();
+
+RenderQueueStats render_queue_get_stats();
@@ -0,0 +1,138 @@
+#include "scene_uniforms.h"
+#include "constants/screen.h"
+#include "rlights.h"
+#include <assert.h>
+#include <external/glad.h>
+#include <math.h>
+#include <raymath.h>
+#include <stddef.h>
+
+// must match MAX_VIEWS in scene.glsl
+#define SCENE_MAX_VIEWS 4
+static_assert(MAX_VIEWS <= SCENE_MAX_VIEWS,
+			  "Scene uniform block can't hold every view");
+
+/// One light of the Scene block, laid out for std140
+typedef struct
+{
+	int enabled;
+	int type;
+	float padding0[2];
+	Vector3 position;
+	float padding1;
+	Vector3 target;
+	float padding2;
+	/// rgba, 0 to 1
+	Vector4 color;
+} SceneLight;
+
+/// Everything in the Scene uniform block, laid out for std140. Keep in sync
+/// with the block in assets/materials/scene.glsl.
+typedef struct
+{
+	SceneLight lights[MAX_LIGHTS];
+	Vector4 ambient;
+	/// view * projection matrix of each view, column major
+	float16 view_mvps[SCENE_MAX_VIEWS];
+	/// RenderView.viewport_transform of each view
+	Vector4 view_transforms[SCENE_MAX_VIEWS];
+	/// camera position of each view, w unused
+	Vector4 view_positions[SCENE_MAX_VIEWS];
+	int view_count;
+	float padding[3];
+} SceneBlock;
+
+static_assert(sizeof(SceneLight) == 64, "SceneLight doesn't match std140");
+static_assert(offsetof(SceneBlock, view_mvps) == 272,
+			  "SceneBlock doesn't match std140");
+static_assert(offsetof(SceneBlock, view_count) == 656,
+			  "SceneBlock doesn't match std140");
+
+static unsigned int buffer;
+static SceneBlock block;
+
+static SceneLight scene_light_directional(Vector3 direction, Color color);
+
+void scene_uniforms_init()
+{
+	// the sun, and a dim light from the other side so nothing is pitch black
+	block.lights[0] =
+		scene_light_directional((Vector3){-2, -4, -3}, WHITE);
+	block.lights[1] = scene_light_directional((Vector3){2, 2, 5}, GRAY);
+	block.ambient = (Vector4){0.1f, 0.1f, 0.1f, 1.0f};
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(SceneBlock), &block,
+				 GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, SCENE_UNIFORMS_BINDING, buffer);
+}
+
+void scene_uniforms_cleanup() { glDeleteBuffers(1, &buffer); }
+
+void scene_uniforms_bind_shader(Shader shader)
+{
+	const GLuint index = glGetUniformBlockIndex(shader.id, "Scene");
+	if (index == GL_INVALID_INDEX) {
+		TraceLog(LOG_WARNING, "shader %d has no Scene uniform block",
+				 shader.id);
+		return;
+	}
+	glUniformBlockBinding(shader.id, index, SCENE_UNIFORMS_BINDING);
+}
+
+void scene_uniforms_set_views(const RenderView* views, uint8_t view_count)
+{
+	assert(view_count > 0 && view_count <= SCENE_MAX_VIEWS);
+	for (uint8_t i = 0; i < view_count; ++i) {
+		block.view_mvps[i] =
+			MatrixToFloatV(render_view_get_view_projection(&views[i]));
+		block.view_transforms[i] = views[i].viewport_transform;
+		const Vector3 position = views[i].camera->camera.position;
+		block.view_positions[i] =
+			(Vector4){position.x, position.y, position.z, 1.0f};
+	}
+	block.view_count = view_count;
+
+	// the lights never change, only send the views
+	const size_t start = offsetof(SceneBlock, view_mvps);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr)start,
+					(GLsizeiptr)(sizeof(SceneBlock) - start),
+					(const char*)&block + start);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+Vector3 scene_uniforms_get_diffuse(Vector3 normal)
+{
+	// the shaders scale ambient down by ten
+	Vector3 total = Vector3Scale(
+		(Vector3){block.ambient.x, block.ambient.y, block.ambient.z}, 0.1f);
+	for (uint8_t i = 0; i < MAX_LIGHTS; ++i) {
+		const SceneLight* light = &block.lights[i];
+		if (!light->enabled || light->type != LIGHT_DIRECTIONAL) {
+			continue;
+		}
+		const Vector3 to_light = Vector3Negate(
+			Vector3Normalize(Vector3Subtract(light->target, light->position)));
+		const float n_dot_l = fmaxf(Vector3DotProduct(normal, to_light), 0);
+		total = Vector3Add(
+			total, Vector3Scale((Vector3){light->color.x, light->color.y,
+										  light->color.z},
+								n_dot_l));
+	}
+	return total;
+}
+
+static SceneLight scene_light_directional(Vector3 direction, Color color)
+{
+	// directional lights shine from position toward target
+	return (SceneLight){
+		.enabled = 1,
+		.type = LIGHT_DIRECTIONAL,
+		.position = Vector3Zero(),
+		.target = direction,
+		.color = ColorNormalize(color),
+	};
+}
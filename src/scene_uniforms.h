@@ -0,0 +1,27 @@
+#pragma once
+#include "render_pipeline.h"
+#include <raylib.h>
+#include <stdint.h>
+
+/// Uniform buffer binding point of the Scene block
+#define SCENE_UNIFORMS_BINDING 0
+
+/// Create the uniform buffer shared by every material shader and fill in the
+/// lights. Needs an OpenGL context.
+void scene_uniforms_init();
+
+void scene_uniforms_cleanup();
+
+/// Point a shader's Scene uniform block at the shared buffer. Shaders without
+/// the block are left alone.
+void scene_uniforms_bind_shader(Shader shader);
+
+/// The light reaching a surface facing normal from the directional lights,
+/// plus ambient, added up the way the lit shaders do it but without specular.
+/// The lights never move, so this can be baked.
+Vector3 scene_uniforms_get_diffuse(Vector3 normal);
+
+/// Upload the cameras of the views which are about to be drawn. Call before
+/// each pass, multi-view shaders draw view i % view_count for instance i.
+/// @param view_count: number no greater than MAX_VIEWS
+void scene_uniforms_set_views(const RenderView* views, uint8_t view_count);
@@ -0,0 +1,414 @@
+#include "shader_cache.h"
+#include "constants/general.h"
+#include "shader_source.h"
+#include "threadutils.h"
+#include <external/glad.h>
+#include <rlgl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define SHADER_CACHE_MAGIC 0x43534644u // "DFSC"
+#define SHADER_CACHE_VERSION 1u
+#define SHADER_CACHE_INITIAL_CAPACITY 16
+
+// 64 bit FNV-1a
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+/// Start of the cache file. Followed by count entries, each a
+/// CacheEntryHeader and then length bytes of program binary.
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t count;
+} CacheFileHeader;
+
+typedef struct
+{
+	uint64_t key;
+	uint32_t format;
+	uint32_t length;
+} CacheEntryHeader;
+
+typedef struct
+{
+	CacheEntryHeader header;
+	uint8_t* data;
+	/// loaded or stored this run, so worth saving
+	bool used;
+} CacheEntry;
+
+static CacheEntry* entries;
+static size_t entry_count;
+static size_t entry_capacity;
+/// false if the driver can't give out program binaries, then every shader is
+/// compiled from source
+static bool supported;
+/// something was compiled since the file was read
+static bool dirty;
+/// hash of everything besides the sources which decides what a binary
+/// contains: the driver, and the raylib whose defaults fill in missing stages
+static uint64_t driver_hash;
+static ShaderCacheStats stats;
+
+static uint64_t shader_cache_hash(uint64_t hash, const void* data,
+								  size_t size);
+
+static uint64_t shader_cache_key(const char* vs_code, const char* fs_code);
+
+/// Parse the cache file into entries. Stops at the first thing which doesn't
+/// add up, keeping whatever was read before it.
+static void shader_cache_read(const uint8_t* file, size_t size);
+
+static CacheEntry* shader_cache_find(uint64_t key);
+
+/// Create a program from a cached binary. Returns 0 if the driver rejects it.
+static unsigned int shader_cache_link_binary(const CacheEntry* entry);
+
+/// Save a linked program's binary under key, replacing any old binary.
+static void shader_cache_store(uint64_t key, unsigned int program);
+
+/// Fill in the shader locations the way LoadShaderFromMemory does.
+static void shader_cache_locate(Shader* shader);
+
+void shader_cache_init()
+{
+	GLint formats = 0;
+	if (GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary) {
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	}
+	supported = formats > 0;
+	if (!supported) {
+		TraceLog(LOG_INFO,
+				 "shader cache: driver has no program binary formats, "
+				 "compiling every shader");
+		return;
+	}
+
+	driver_hash = FNV_OFFSET_BASIS;
+	const GLenum driver_strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+	for (size_t i = 0; i < sizeof(driver_strings) / sizeof(driver_strings[0]);
+		 ++i) {
+		const char* string = (const char*)glGetString(driver_strings[i]);
+		if (string != NULL) {
+			driver_hash =
+				shader_cache_hash(driver_hash, string, strlen(string) + 1);
+		}
+	}
+	driver_hash = shader_cache_hash(driver_hash, RAYLIB_VERSION,
+									sizeof(RAYLIB_VERSION));
+
+	entry_capacity = SHADER_CACHE_INITIAL_CAPACITY;
+	entries = RL_CALLOC(entry_capacity, sizeof(CacheEntry));
+	CHECKMEM(entries);
+
+	if (!FileExists(SHADER_CACHE_PATH)) {
+		return;
+	}
+	unsigned int size = 0;
+	uint8_t* file = LoadFileData(SHADER_CACHE_PATH, &size);
+	if (file != NULL) {
+		shader_cache_read(file, size);
+		UnloadFileData(file);
+	}
+	TraceLog(LOG_INFO, "shader cache: %zu program binaries on disk",
+			 entry_count);
+}
+
+Shader shader_cache_load(const char* vs_file_name, const char* fs_file_name)
+{
+	char* vs_code =
+		vs_file_name ? shader_source_read(vs_file_name, NULL) : NULL;
+	char* fs_code =
+		fs_file_name ? shader_source_read(fs_file_name, NULL) : NULL;
+	const Shader shader = shader_cache_load_from_memory(vs_code, fs_code);
+	RL_FREE(vs_code);
+	RL_FREE(fs_code);
+	return shader;
+}
+
+Shader shader_cache_load_from_memory(const char* vs_code, const char* fs_code)
+{
+	const double start = GetTime();
+	Shader shader = {0};
+	const uint64_t key = supported ? shader_cache_key(vs_code, fs_code) : 0;
+
+	CacheEntry* entry = supported ? shader_cache_find(key) : NULL;
+	if (entry != NULL) {
+		shader.id = shader_cache_link_binary(entry);
+		if (shader.id != 0) {
+			entry->used = true;
+			shader_cache_locate(&shader);
+			++stats.hits;
+			TraceLog(LOG_INFO, "SHADER: [ID %u] Program loaded from cache",
+					 shader.id);
+		} else {
+			// usually a driver update which kept the same version string
+			++stats.rejected;
+			TraceLog(LOG_WARNING,
+					 "shader cache: driver rejected a cached program, "
+					 "compiling it again");
+		}
+	}
+
+	if (shader.id == 0) {
+		shader = LoadShaderFromMemory(vs_code, fs_code);
+		++stats.misses;
+		// a failed compile falls back to raylib's default shader, which is
+		// not ours to save
+		if (supported && shader.id != rlGetShaderIdDefault()) {
+			shader_cache_store(key, shader.id);
+		}
+	}
+
+	stats.load_ms += (GetTime() - start) * 1000.0;
+	return shader;
+}
+
+void shader_cache_save()
+{
+	TraceLog(LOG_INFO,
+			 "shader cache: %zu programs from cache, %zu compiled (%zu "
+			 "rejected), %.1f ms spent loading shaders",
+			 stats.hits, stats.misses, stats.rejected, stats.load_ms);
+	if (!supported) {
+		return;
+	}
+
+	size_t size = sizeof(CacheFileHeader);
+	uint32_t count = 0;
+	bool stale = false;
+	for (size_t i = 0; i < entry_count; ++i) {
+		if (entries[i].used) {
+			size += sizeof(CacheEntryHeader) + entries[i].header.length;
+			++count;
+		} else {
+			stale = true;
+		}
+	}
+	if (!dirty && !stale) {
+		return;
+	}
+
+	uint8_t* file = RL_MALLOC(size);
+	CHECKMEM(file);
+	const CacheFileHeader header = {
+		.magic = SHADER_CACHE_MAGIC,
+		.version = SHADER_CACHE_VERSION,
+		.count = count,
+	};
+	memcpy(file, &header, sizeof(header));
+	size_t offset = sizeof(header);
+	for (size_t i = 0; i < entry_count; ++i) {
+		if (!entries[i].used) {
+			continue;
+		}
+		memcpy(file + offset, &entries[i].header, sizeof(CacheEntryHeader));
+		offset += sizeof(CacheEntryHeader);
+		memcpy(file + offset, entries[i].data, entries[i].header.length);
+		offset += entries[i].header.length;
+	}
+	if (!SaveFileData(SHADER_CACHE_PATH, file, (unsigned int)size)) {
+		TraceLog(LOG_WARNING, "shader cache: failed to write %s",
+				 SHADER_CACHE_PATH);
+	}
+	RL_FREE(file);
+	dirty = false;
+}
+
+ShaderCacheStats shader_cache_get_stats() { return stats; }
+
+void shader_cache_cleanup()
+{
+	for (size_t i = 0; i < entry_count; ++i) {
+		RL_FREE(entries[i].data);
+	}
+	RL_FREE(entries);
+	entries = NULL;
+	entry_count = 0;
+	entry_capacity = 0;
+}
+
+static uint64_t shader_cache_hash(uint64_t hash, const void* data, size_t size)
+{
+	const uint8_t* bytes = data;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+static uint64_t shader_cache_key(const char* vs_code, const char* fs_code)
+{
+	// a missing stage is raylib's default, which driver_hash already covers.
+	// the terminators keep the two sources from running into each other
+	static const char default_stage[] = "";
+	uint64_t key = driver_hash;
+	key = shader_cache_hash(key, vs_code ? vs_code : default_stage,
+							vs_code ? strlen(vs_code) + 1 : 1);
+	key = shader_cache_hash(key, fs_code ? fs_code : default_stage,
+							fs_code ? strlen(fs_code) + 1 : 1);
+	return key;
+}
+
+static void shader_cache_read(const uint8_t* file, size_t size)
+{
+	CacheFileHeader header;
+	if (size < sizeof(header)) {
+		return;
+	}
+	memcpy(&header, file, sizeof(header));
+	if (header.magic != SHADER_CACHE_MAGIC ||
+		header.version != SHADER_CACHE_VERSION) {
+		TraceLog(LOG_WARNING, "shader cache: ignoring %s, unknown format",
+				 SHADER_CACHE_PATH);
+		return;
+	}
+
+	size_t offset = sizeof(header);
+	for (uint32_t i = 0; i < header.count; ++i) {
+		CacheEntryHeader entry_header;
+		if (size - offset < sizeof(entry_header)) {
+			break;
+		}
+		memcpy(&entry_header, file + offset, sizeof(entry_header));
+		offset += sizeof(entry_header);
+		if (size - offset < entry_header.length) {
+			break;
+		}
+
+		uint8_t* data = RL_MALLOC(entry_header.length);
+		CHECKMEM(data);
+		memcpy(data, file + offset, entry_header.length);
+		offset += entry_header.length;
+
+		if (entry_count == entry_capacity) {
+			entry_capacity *= 2;
+			entries = RL_REALLOC(entries, entry_capacity * sizeof(CacheEntry));
+			CHECKMEM(entries);
+		}
+		entries[entry_count++] = (CacheEntry){
+			.header = entry_header,
+			.data = data,
+		};
+	}
+	if (entry_count != header.count) {
+		TraceLog(LOG_WARNING, "shader cache: %s is truncated",
+				 SHADER_CACHE_PATH);
+	}
+}
+
+static CacheEntry* shader_cache_find(uint64_t key)
+{
+	for (size_t i = 0; i < entry_count; ++i) {
+		if (entries[i].header.key == key) {
+			return &entries[i];
+		}
+	}
+	return NULL;
+}
+
+static unsigned int shader_cache_link_binary(const CacheEntry* entry)
+{
+	const GLuint program = glCreateProgram();
+	glProgramBinary(program, entry->header.format, entry->data,
+					(GLsizei)entry->header.length);
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE) {
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+static void shader_cache_store(uint64_t key, unsigned int program)
+{
+	// raylib links without GL_PROGRAM_BINARY_RETRIEVABLE_HINT. that's only a
+	// hint, drivers which care hand back nothing and the program just isn't
+	// cached
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+	uint8_t* data = RL_MALLOC((size_t)length);
+	CHECKMEM(data);
+	GLenum format = 0;
+	GLsizei written = 0;
+	glGetProgramBinary(program, length, &written, &format, data);
+	if (written <= 0) {
+		RL_FREE(data);
+		return;
+	}
+
+	CacheEntry* entry = shader_cache_find(key);
+	if (entry == NULL) {
+		if (entry_count == entry_capacity) {
+			entry_capacity *= 2;
+			entries = RL_REALLOC(entries, entry_capacity * sizeof(CacheEntry));
+			CHECKMEM(entries);
+		}
+		entry = &entries[entry_count++];
+	} else {
+		RL_FREE(entry->data);
+	}
+	*entry = (CacheEntry){
+		.header =
+			{
+				.key = key,
+				.format = format,
+				.length = (uint32_t)written,
+			},
+		.data = data,
+		.used = true,
+	};
+	dirty = true;
+}
+
+static void shader_cache_locate(Shader* shader)
+{
+	shader->locs = RL_CALLOC(RL_MAX_SHADER_LOCATIONS, sizeof(int));
+	CHECKMEM(shader->locs);
+	for (int i = 0; i < RL_MAX_SHADER_LOCATIONS; ++i) {
+		shader->locs[i] = -1;
+	}
+	const unsigned int id = shader->id;
+	int* locs = shader->locs;
+
+	locs[SHADER_LOC_VERTEX_POSITION] =
+		rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_POSITION);
+	locs[SHADER_LOC_VERTEX_TEXCOORD01] =
+		rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_TEXCOORD);
+	locs[SHADER_LOC_VERTEX_TEXCOORD02] =
+		rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_TEXCOORD2);
+	locs[SHADER_LOC_VERTEX_NORMAL] =
+		rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_NORMAL);
+	locs[SHADER_LOC_VERTEX_TANGENT] =
+		rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_TANGENT);
+	locs[SHADER_LOC_VERTEX_COLOR] =
+		rlGetLocationAttrib(id, RL_DEFAULT_SHADER_ATTRIB_NAME_COLOR);
+
+	locs[SHADER_LOC_MATRIX_MVP] =
+		rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_MVP);
+	locs[SHADER_LOC_MATRIX_VIEW] =
+		rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_VIEW);
+	locs[SHADER_LOC_MATRIX_PROJECTION] =
+		rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_PROJECTION);
+	locs[SHADER_LOC_MATRIX_MODEL] =
+		rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_MODEL);
+	locs[SHADER_LOC_MATRIX_NORMAL] =
+		rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_NORMAL);
+
+	locs[SHADER_LOC_COLOR_DIFFUSE] =
+		rlGetLocationUniform(id, RL_DEFAULT_SHADER_UNIFORM_NAME_COLOR);
+	locs[SHADER_LOC_MAP_DIFFUSE] =
+		rlGetLocationUniform(id, RL_DEFAULT_SHADER_SAMPLER2D_NAME_TEXTURE0);
+	locs[SHADER_LOC_MAP_SPECULAR] =
+		rlGetLocationUniform(id, RL_DEFAULT_SHADER_SAMPLER2D_NAME_TEXTURE1);
+	locs[SHADER_LOC_MAP_NORMAL] =
+		rlGetLocationUniform(id, RL_DEFAULT_SHADER_SAMPLER2D_NAME_TEXTURE2);
+}
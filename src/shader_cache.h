@@ -0,0 +1,38 @@
+#pragma once
+#include <raylib.h>
+#include <stddef.h>
+
+/// How shader loading went since shader_cache_init.
+typedef struct
+{
+	/// programs loaded from a binary saved by an earlier run
+	size_t hits;
+	/// programs compiled and linked from source
+	size_t misses;
+	/// cached binaries the driver refused, which were compiled instead
+	size_t rejected;
+	/// time spent loading shaders either way, in milliseconds
+	double load_ms;
+} ShaderCacheStats;
+
+/// Read the binaries saved by the last run. Needs an OpenGL context. Does
+/// nothing but count if the driver can't hand out program binaries.
+void shader_cache_init();
+
+/// Same as raylib's LoadShader, but the linked program is reused from the
+/// cache when the sources and driver match the last time it was linked. Both
+/// sources are read with shader_source_read.
+Shader shader_cache_load(const char* vs_file_name, const char* fs_file_name);
+
+/// Same as raylib's LoadShaderFromMemory, but cached like shader_cache_load.
+/// The sources are used as they are.
+Shader shader_cache_load_from_memory(const char* vs_code, const char* fs_code);
+
+/// Write every program loaded this run back to SHADER_CACHE_PATH, if anything
+/// had to be compiled. Programs which weren't loaded this run are dropped.
+/// Logs how long shaders took to load.
+void shader_cache_save();
+
+ShaderCacheStats shader_cache_get_stats();
+
+void shader_cache_cleanup();
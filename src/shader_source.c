@@ -0,0 +1,50 @@
+#include "shader_source.h"
+#include "constants/general.h"
+#include "threadutils.h"
+#include <string.h>
+
+char* shader_source_read(const char* file_name, const char* define)
+{
+	char* source = LoadFileText(file_name);
+	if (source == NULL) {
+		return NULL;
+	}
+	char* shared = LoadFileText(SHADER_SHARED_SOURCE_PATH);
+	if (shared == NULL) {
+		TraceLog(LOG_WARNING, "shader source: missing shared source %s",
+				 SHADER_SHARED_SOURCE_PATH);
+	}
+
+	const char* version_end = strchr(source, '\n');
+	const size_t version_length =
+		version_end ? (size_t)(version_end - source) + 1 : strlen(source);
+	// each piece, in the order they end up in. the #line puts compile errors
+	// back on the file's own line numbers
+	const char* pieces[] = {
+		source,
+		define ? "#define " : "",
+		define ? define : "",
+		define ? "\n" : "",
+		shared ? shared : "",
+		"\n#line 2\n",
+		source + version_length,
+	};
+	size_t lengths[sizeof(pieces) / sizeof(pieces[0])];
+	size_t length = 0;
+	for (size_t i = 0; i < sizeof(pieces) / sizeof(pieces[0]); ++i) {
+		lengths[i] = i == 0 ? version_length : strlen(pieces[i]);
+		length += lengths[i];
+	}
+
+	char* result = RL_MALLOC(length + 1);
+	CHECKMEM(result);
+	size_t offset = 0;
+	for (size_t i = 0; i < sizeof(pieces) / sizeof(pieces[0]); ++i) {
+		memcpy(result + offset, pieces[i], lengths[i]);
+		offset += lengths[i];
+	}
+	result[length] = '\0';
+	UnloadFileText(shared);
+	UnloadFileText(source);
+	return result;
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <raylib.h>
+
+/// Read a shader source file with the declarations every shader shares, from
+/// SHADER_SHARED_SOURCE_PATH, added right after its #version line. If define
+/// isn't NULL, a line defining it comes before them. Returns NULL if the file
+/// can't be read, otherwise free the result with RL_FREE.
+char* shader_source_read(const char* file_name, const char* define);
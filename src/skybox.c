@@ -1,5 +1,8 @@
 #include "shorthand.h"
 #include "constants/general.h"
+#include "gpu_timer.h"
+#include "render_queue.h"
+#include "shader_cache.h"
 #include <raylib.h>
 #include <raymath.h>
 #include <rlgl.h>
@@ -46,14 +49,17 @@ static const SkyboxInfo working_example = {
 static TextureCubemap GenTextureCubemap(Shader shader, Texture2D panorama,
 										int size, int format);
 
+static void skybox_draw_queued(const void* data);
+
 void skybox_draw()
 {
-	// We are inside the cube, we need to disable backface culling!
-	rlDisableBackfaceCulling();
-	rlDisableDepthMask();
-	DrawModel(skybox, (Vector3){0, 0, 0}, 1.0f, WHITE);
-	rlEnableBackfaceCulling();
-	rlEnableDepthMask();
+	render_queue_push(&(RenderCommand){
+		.pass = RENDER_PASS_SKY,
+		.shader = skybox.materials[0].shader.id,
+		.texture = skybox.materials[0].maps[MATERIAL_MAP_CUBEMAP].texture.id,
+		.vao = skybox.meshes[0].vaoId,
+		.draw = skybox_draw_queued,
+	});
 }
 
 void skybox_load()
@@ -70,7 +76,7 @@ void skybox_load()
 
 	// Load skybox shader and set required locations
 	// NOTE Some locations are automatically set at shader loading
-	skybox.materials[0].shader = LoadShader(
+	skybox.materials[0].shader = shader_cache_load(
 		TextFormat("%s/skybox/common/shaders/skybox.vert", ASSETS_FOLDER),
 		TextFormat("%s/skybox/common/shaders/skybox.frag", ASSETS_FOLDER));
 
@@ -88,7 +94,7 @@ void skybox_load()
 				   SHADER_UNIFORM_INT);
 
 	// Load cubemap shader and setup required shader locations
-	Shader shdrCubemap = LoadShader(
+	Shader shdrCubemap = shader_cache_load(
 		TextFormat("%s/skybox/common/shaders/cubemap.vert", ASSETS_FOLDER),
 		TextFormat("%s/skybox/common/shaders/cubemap.frag", ASSETS_FOLDER));
 
@@ -127,6 +133,21 @@ void skybox_cleanup()
 	UnloadModel(skybox);
 }
 
+static void skybox_draw_queued(const void* data)
+{
+	UNUSED(data);
+	gpu_timer_begin(GPU_TIMER_SKY);
+	// We are inside the cube, we need to disable backface culling! the
+	// shader puts the cube on the far plane, so it passes raylib's LEQUAL
+	// depth test only where nothing else was drawn
+	rlDisableBackfaceCulling();
+	rlDisableDepthMask();
+	DrawModel(skybox, (Vector3){0, 0, 0}, 1.0f, WHITE);
+	rlEnableBackfaceCulling();
+	rlEnableDepthMask();
+	gpu_timer_end(GPU_TIMER_SKY);
+}
+
 // Generate cubemap texture from HDR texture
 static TextureCubemap GenTextureCubemap(Shader shader, Texture2D panorama,
 										int size, int format)
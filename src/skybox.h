@@ -1,5 +1,6 @@
 #pragma once
 
+/// Queue the skybox, behind everything else in the view.
 void skybox_draw();
 void skybox_load();
 void skybox_cleanup();
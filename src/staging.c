@@ -0,0 +1,166 @@
+#include "staging.h"
+#include "threadutils.h"
+#include <assert.h>
+#include <external/glad.h>
+#include <raylib.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+/// Segments in the ring. With one filled per frame, the GPU has two frames to
+/// finish copying out of a segment before it is written again.
+#define STAGING_SEGMENTS 3
+#define STAGING_SEGMENT_BYTES (8 << 20)
+/// Ranges start on this boundary, enough for any vertex attribute
+#define STAGING_ALIGNMENT 16
+/// How long staging_fence waits on the GPU before checking again
+#define STAGING_WAIT_TIMEOUT_NS 1000000
+
+typedef struct
+{
+	/// the mapped buffer, 0 when copies are made with glBufferSubData
+	unsigned int buffer;
+	uint8_t* memory;
+	/// segment ranges are currently handed out of
+	uint8_t segment;
+	/// bytes handed out of the current segment
+	atomic_size_t used;
+	/// signalled once the GPU is done with each segment's copies, NULL when
+	/// nothing was copied out of it
+	GLsync fences[STAGING_SEGMENTS];
+	StagingStats stats;
+	atomic_size_t full;
+} StagingRing;
+
+static StagingRing ring;
+
+void staging_init()
+{
+	const size_t bytes = (size_t)STAGING_SEGMENTS * STAGING_SEGMENT_BYTES;
+	if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) {
+		// coherent, so writes show up to the GPU without explicit flushes
+		const GLbitfield flags =
+			GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glGenBuffers(1, &ring.buffer);
+		glBindBuffer(GL_COPY_READ_BUFFER, ring.buffer);
+		glBufferStorage(GL_COPY_READ_BUFFER, (GLsizeiptr)bytes, NULL, flags);
+		ring.memory =
+			glMapBufferRange(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)bytes, flags);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		if (ring.memory == NULL) {
+			TraceLog(LOG_WARNING, "staging: failed to map staging buffer");
+			glDeleteBuffers(1, &ring.buffer);
+			ring.buffer = 0;
+		}
+	}
+	if (ring.memory == NULL) {
+		ring.memory = RL_MALLOC(bytes);
+		CHECKMEM(ring.memory);
+	}
+	ring.segment = 0;
+	atomic_init(&ring.used, 0);
+	atomic_init(&ring.full, 0);
+	TraceLog(LOG_INFO, "staging: uploading through %s",
+			 ring.buffer != 0 ? "a persistently mapped buffer"
+							  : "glBufferSubData");
+}
+
+void staging_cleanup()
+{
+	for (uint8_t i = 0; i < STAGING_SEGMENTS; ++i) {
+		if (ring.fences[i] != NULL) {
+			glDeleteSync(ring.fences[i]);
+		}
+	}
+	if (ring.buffer != 0) {
+		glBindBuffer(GL_COPY_READ_BUFFER, ring.buffer);
+		glUnmapBuffer(GL_COPY_READ_BUFFER);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glDeleteBuffers(1, &ring.buffer);
+	} else {
+		RL_FREE(ring.memory);
+	}
+	ring = (StagingRing){0};
+}
+
+bool staging_is_persistent() { return ring.buffer != 0; }
+
+StagingRange staging_alloc(size_t size)
+{
+	const size_t aligned =
+		(size + STAGING_ALIGNMENT - 1) & ~(size_t)(STAGING_ALIGNMENT - 1);
+	size_t used = atomic_load(&ring.used);
+	do {
+		if (ring.memory == NULL || used + aligned > STAGING_SEGMENT_BYTES) {
+			atomic_fetch_add(&ring.full, 1);
+			return (StagingRange){0};
+		}
+	} while (!atomic_compare_exchange_weak(&ring.used, &used, used + aligned));
+
+	const size_t offset =
+		((size_t)ring.segment * STAGING_SEGMENT_BYTES) + used;
+	return (StagingRange){
+		.data = ring.memory + offset,
+		.offset = offset,
+		.size = size,
+	};
+}
+
+void staging_copy(const StagingRange* range, size_t offset, size_t size,
+				  unsigned int buffer, size_t buffer_offset)
+{
+	assert(range->data != NULL);
+	assert(offset + size <= range->size);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	if (ring.buffer != 0) {
+		glBindBuffer(GL_COPY_READ_BUFFER, ring.buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+							(GLintptr)(range->offset + offset),
+							(GLintptr)buffer_offset, (GLsizeiptr)size);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	} else {
+		glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)buffer_offset,
+						(GLsizeiptr)size, (const uint8_t*)range->data + offset);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	++ring.stats.copies;
+	ring.stats.bytes_copied += size;
+}
+
+void staging_fence()
+{
+	if (atomic_load(&ring.used) == 0) {
+		// nothing to fence, keep filling the same segment
+		return;
+	}
+	if (ring.buffer != 0) {
+		assert(ring.fences[ring.segment] == NULL);
+		ring.fences[ring.segment] =
+			glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	ring.segment = (ring.segment + 1) % STAGING_SEGMENTS;
+
+	GLsync fence = ring.fences[ring.segment];
+	if (fence != NULL) {
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			++ring.stats.waits;
+			do {
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+										  STAGING_WAIT_TIMEOUT_NS);
+			} while (result == GL_TIMEOUT_EXPIRED);
+		}
+		if (result == GL_WAIT_FAILED) {
+			TraceLog(LOG_WARNING, "staging: waiting on a fence failed");
+		}
+		glDeleteSync(fence);
+		ring.fences[ring.segment] = NULL;
+	}
+	atomic_store(&ring.used, 0);
+}
+
+StagingStats staging_get_stats()
+{
+	StagingStats stats = ring.stats;
+	stats.full = atomic_load(&ring.full);
+	return stats;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// A ring of memory which vertex data is written into before being copied
+/// into GL buffers. When the driver supports it (GL 4.4 or
+/// ARB_buffer_storage) the ring is one persistently mapped buffer, so
+/// producers write straight into memory the GPU copies from and nothing is
+/// handed to the driver until the copy. Otherwise the ring is plain memory and
+/// copies go through glBufferSubData.
+///
+/// The ring is split into segments. Ranges are handed out of the current
+/// segment until staging_fence moves on to the next one, which waits for the
+/// GPU to finish copying out of it the last time around.
+
+/// A piece of the ring, valid until the next staging_fence. data is NULL if
+/// the ring had no room.
+typedef struct
+{
+	void* data;
+	/// byte offset into the ring
+	size_t offset;
+	size_t size;
+} StagingRange;
+
+/// How the ring has been used, since staging_init.
+typedef struct
+{
+	/// copies issued out of the ring
+	size_t copies;
+	size_t bytes_copied;
+	/// allocations which did not fit in the current segment
+	size_t full;
+	/// times staging_fence had to wait on the GPU to reuse a segment
+	size_t waits;
+} StagingStats;
+
+/// Create the ring. Needs a GL context.
+void staging_init();
+
+void staging_cleanup();
+
+/// Whether the ring is a persistently mapped buffer, rather than memory
+/// uploaded with glBufferSubData.
+bool staging_is_persistent();
+
+/// Reserve size bytes for writing. Safe to call from any thread. The range
+/// must be passed to staging_copy before the next staging_fence, after that
+/// the GPU may be reading it.
+StagingRange staging_alloc(size_t size);
+
+/// Copy size bytes, starting offset bytes into a staged range, into a GL
+/// buffer. Render thread only.
+void staging_copy(const StagingRange* range, size_t offset, size_t size,
+				  unsigned int buffer, size_t buffer_offset);
+
+/// Fence the copies made out of the current segment and move on to the next
+/// one. Render thread only, and no other thread may be allocating. Called
+/// once a frame, and whenever a loader fills up a segment mid frame.
+void staging_fence();
+
+StagingStats staging_get_stats();
@@ -1,11 +1,23 @@
 #include "terrain_internal.h"
 #include "constants/general.h"
+#include "constants/screen.h"
+#include "frustum.h"
+#include "gl_state.h"
+#include "gpu_timer.h"
 #include "mesher.h"
-#include "rlights.h"
+#include "occlusion.h"
+#include "radix_sort.h"
+#include "render_queue.h"
+#include "scene_uniforms.h"
+#include "shader_cache.h"
+#include "shader_source.h"
+#include "shorthand.h"
 #include "terrain.h"
+#include "terrain_clipmap.h"
 #include "terrain_render.h"
 #include "terrain_voxel_data.h"
 #include "threadutils.h"
+#include <limits.h>
 #include <math.h>
 #include <raymath.h>
 #include <stdio.h>
@@ -30,25 +42,183 @@ static Material terrain_mat;
 static PlayerPosition* player_positions;
 static RenderTexture texture_atlas;
 static IntermediateVoxelData* voxel_data;
+static TerrainDrawStats draw_stats[MAX_VIEWS];
+/// world-space xz rectangle of loaded chunks around each plane, as (min x,
+/// min z, max x, max z). the clipmap fills in everything outside of these
+static Vector4 voxel_regions[NUM_PLANES];
+/// vertices of the chunk sides which passed culling, reused every terrain_draw
+static TerrainMeshRange* visible_ranges;
+/// chunks with any faces at all, gathered once per frame by terrain_prepare so
+/// each view only walks the chunks it could draw
+static const Chunk** drawable_chunks;
+static size_t drawable_count;
+/// solid cores of chunks which are worth rasterizing for occlusion culling,
+/// also gathered by terrain_prepare
+static const BoundingBox** occluders;
+static size_t occluder_count;
+/// bitmask of the sides of each of drawable_chunks which any view being drawn
+/// can see
+static uint8_t* drawable_sides;
+/// indices into drawable_chunks of the chunks which are visible, sorted front
+/// to back, plus scratch space for sorting them
+static RadixSortItem* visible_order;
+static RadixSortItem* visible_order_scratch;
+/// number of visible_ranges and views in the queued terrain draw
+static size_t queued_range_count;
+static uint8_t queued_view_count;
 
 static void terrain_generate_mesh_for_chunk(ChunkCoords chunk_coords,
-											Chunk* out_chunk);
+											uint8_t lod, Chunk* out_chunk);
 
 static void terrain_update_chunks();
 
-void terrain_draw()
+/// Remesh any loaded chunks whose level of detail no longer matches their
+/// distance to the planes. Returns the number of chunks remeshed.
+static size_t terrain_update_chunk_lods();
+
+static uint8_t terrain_chunk_lod(ChunkCoords chunk_coords);
+
+static ChunkCoords terrain_player_chunk(uint8_t plane_index);
+
+/// Find which sides of a chunk could have faces facing the camera, as a
+/// bitmask with bit n set for side n. Counts the triangles drawn and skipped.
+static uint8_t terrain_chunk_facing_sides(const Chunk* chunk,
+										  Vector3 camera_position,
+										  TerrainDrawStats* stats);
+
+/// Append the ranges of the given sides of a chunk to visible_ranges, starting
+/// at index count. Returns the new count.
+static size_t terrain_chunk_add_sides(const Chunk* chunk, uint8_t sides,
+									  size_t count);
+
+static void terrain_draw_queued(const void* data);
+
+/// Load the lit material shader, with the light table filled in if
+/// TERRAIN_BAKED_LIGHTING is on.
+static Shader terrain_load_shader();
+
+void terrain_prepare()
 {
+	drawable_count = 0;
+	occluder_count = 0;
 	for (size_t i = 0; i < terrain_data->count; ++i) {
-		const ChunkCoords* pos = &terrain_data->chunks[i].position;
-		DrawMesh(terrain_data->chunks[i].mesh, terrain_mat,
-				 MatrixTranslate((float)pos->x * (1.0f / CHUNK_SIZE), 0,
-								 (float)pos->z * (1.0f / CHUNK_SIZE)));
+		const Chunk* chunk = &terrain_data->chunks[i];
+		if (chunk->range.count != 0) {
+			drawable_chunks[drawable_count++] = chunk;
+		}
+		if (chunk->occluder.max.y > chunk->occluder.min.y) {
+			occluders[occluder_count++] = &chunk->occluder;
+		}
 	}
 }
 
+void terrain_draw(const RenderView* views, uint8_t view_count)
+{
+	for (size_t i = 0; i < drawable_count; ++i) {
+		drawable_sides[i] = 0;
+	}
+
+	for (uint8_t v = 0; v < view_count; ++v) {
+		const RenderView* view = &views[v];
+		assert(view->index < MAX_VIEWS);
+		const double cull_start = GetTime();
+		const Matrix view_projection = render_view_get_view_projection(view);
+		const Frustum frustum = frustum_from_view_projection(view_projection);
+		TerrainDrawStats stats = {0};
+		// chunks without faces never make it into drawable_chunks
+		stats.culled = terrain_data->count - drawable_count;
+
+		// every chunk's solid core goes into the depth buffer before anything
+		// is tested against it
+		occlusion_begin(view_projection);
+		for (size_t i = 0; i < occluder_count; ++i) {
+			occlusion_add_occluder(occluders[i]);
+		}
+
+		for (size_t i = 0; i < drawable_count; ++i) {
+			const Chunk* chunk = drawable_chunks[i];
+			if (!frustum_intersects_aabb(&frustum, &chunk->bounds)) {
+				++stats.culled;
+				continue;
+			}
+			if (!occlusion_is_visible(&chunk->bounds)) {
+				++stats.occluded;
+				continue;
+			}
+			drawable_sides[i] |= terrain_chunk_facing_sides(
+				chunk, view->camera->camera.position, &stats);
+			++stats.drawn;
+		}
+		stats.cull_ms = (GetTime() - cull_start) * 1000.0;
+		draw_stats[view->index] = stats;
+	}
+
+	// nearest chunks first, so the depth test can throw out whatever they
+	// cover before it gets shaded
+	size_t visible_chunks = 0;
+	float nearest_distance = INFINITY;
+	for (size_t i = 0; i < drawable_count; ++i) {
+		if (drawable_sides[i] == 0) {
+			continue;
+		}
+		const BoundingBox* bounds = &drawable_chunks[i]->bounds;
+		const float distance = render_queue_distance(
+			Vector3Scale(Vector3Add(bounds->min, bounds->max), 0.5f));
+		nearest_distance = fminf(nearest_distance, distance);
+		visible_order[visible_chunks++] = (RadixSortItem){
+			.key = radix_sort_float_key(distance),
+			.value = (uint32_t)i,
+		};
+	}
+	radix_sort(visible_order, visible_order_scratch, visible_chunks);
+
+	// one draw for every view, with whatever any of them can see
+	size_t visible_count = 0;
+	for (size_t i = 0; i < visible_chunks; ++i) {
+		const size_t index = visible_order[i].value;
+		visible_count = terrain_chunk_add_sides(
+			drawable_chunks[index], drawable_sides[index], visible_count);
+	}
+	if (visible_count == 0) {
+		return;
+	}
+	queued_range_count = visible_count;
+	queued_view_count = view_count;
+	render_queue_push(&(RenderCommand){
+		.pass = RENDER_PASS_OPAQUE,
+		.shader = terrain_mat.shader.id,
+		.texture = terrain_mat.maps[MATERIAL_MAP_DIFFUSE].texture.id,
+		.vao = terrain_render_get_vao(),
+		.depth = nearest_distance,
+		.tracks_gl_state = true,
+		.draw = terrain_draw_queued,
+	});
+}
+
+static void terrain_draw_queued(const void* data)
+{
+	UNUSED(data);
+	gpu_timer_begin(GPU_TIMER_TERRAIN);
+	terrain_render_draw(&terrain_mat, queued_view_count, visible_ranges,
+						queued_range_count);
+	gpu_timer_end(GPU_TIMER_TERRAIN);
+}
+
+void terrain_draw_distant(const RenderView* view)
+{
+	terrain_clipmap_draw(view, voxel_regions);
+}
+
+TerrainDrawStats terrain_get_draw_stats(uint8_t view_index)
+{
+	assert(view_index < MAX_VIEWS);
+	return draw_stats[view_index];
+}
+
 void terrain_load()
 {
 	init_noise();
+	terrain_clipmap_load();
 	// permanent
 	size_t num_meshes =
 		(size_t)(RENDER_DISTANCE + 1) * RENDER_DISTANCE * NUM_PLANES;
@@ -64,6 +234,15 @@ void terrain_load()
 		(sizeof(terrain_data->available_indices->indices[0]) * num_meshes));
 	terrain_data->available_indices->count = 0;
 	terrain_data->available_indices->capacity = num_meshes;
+	terrain_render_init(num_meshes, num_meshes * NUM_SIDES);
+	visible_ranges =
+		RL_MALLOC(num_meshes * NUM_SIDES * sizeof(TerrainMeshRange));
+	drawable_chunks = RL_MALLOC(num_meshes * sizeof(drawable_chunks[0]));
+	occluders = RL_MALLOC(num_meshes * sizeof(occluders[0]));
+	drawable_sides = RL_MALLOC(num_meshes * sizeof(drawable_sides[0]));
+	visible_order = RL_MALLOC(num_meshes * sizeof(visible_order[0]));
+	visible_order_scratch =
+		RL_MALLOC(num_meshes * sizeof(visible_order_scratch[0]));
 	player_positions = RL_CALLOC(NUM_PLANES, sizeof(PlayerPosition));
 	voxel_data = RL_CALLOC(1, sizeof(IntermediateVoxelData));
 
@@ -81,19 +260,9 @@ void terrain_load()
 	terrain_mat.maps[0].color = WHITE;
 	terrain_mat.maps[0].texture = texture_atlas.texture;
 
-	Shader shader = LoadShader("assets/materials/basic_lit.vert",
-							   "assets/materials/basic_lit.frag");
-	shader.locs[SHADER_LOC_VECTOR_VIEW] = GetShaderLocation(shader, "viewPos");
-
-	int ambientLoc = GetShaderLocation(shader, "ambient");
-	float val[4] = {0.1f, 0.1f, 0.1f, 1.0f};
-	SetShaderValue(shader, ambientLoc, val, SHADER_UNIFORM_VEC4);
-
-	Light lights[MAX_LIGHTS] = {0};
-	lights[0] = CreateLight(LIGHT_DIRECTIONAL, Vector3Zero(),
-							(Vector3){-2, -4, -3}, WHITE, shader);
-	lights[1] = CreateLight(LIGHT_DIRECTIONAL, Vector3Zero(),
-							(Vector3){2, 2, 5}, GRAY, shader);
+	Shader shader = terrain_load_shader();
+	// cameras and lights come from the shared Scene block
+	scene_uniforms_bind_shader(shader);
 	terrain_mat.shader = shader;
 	// only one uv rect lookup option, which just shows the whole texture
 	static const Rectangle basic_uv_rect[] = {{0, 0, 1, 1}};
@@ -106,11 +275,15 @@ void terrain_load()
 	}
 
 	terrain_update_chunks();
+	for (uint8_t i = 0; i < NUM_PLANES; ++i) {
+		terrain_clipmap_update_player_pos(i, player_positions[i].coords);
+	}
 }
 
 void terrain_update_player_pos(uint8_t index, Vector3 pos)
 {
 	assert(index < NUM_PLANES);
+	terrain_clipmap_update_player_pos(index, pos);
 	player_positions[index].prev_coords = player_positions[index].coords;
 	player_positions[index].coords = pos;
 
@@ -135,8 +308,12 @@ void terrain_update_player_pos(uint8_t index, Vector3 pos)
 void terrain_cleanup()
 {
 	for (size_t i = 0; i < terrain_data->count; ++i) {
-		UnloadMesh(terrain_data->chunks[i].mesh);
+		terrain_render_free(&terrain_data->chunks[i].range);
 	}
+	terrain_render_cleanup();
+	terrain_clipmap_cleanup();
+	mesher_scratch_cleanup();
+	gl_state_forget_program(terrain_mat.shader.id);
 	UnloadMaterial(terrain_mat);
 	// not necessary in theory, material should unload the RT. just bein safe
 	UnloadRenderTexture(texture_atlas);
@@ -144,10 +321,54 @@ void terrain_cleanup()
 	RL_FREE(terrain_data);
 	RL_FREE(player_positions);
 	RL_FREE(voxel_data);
+	RL_FREE(visible_ranges);
+	RL_FREE(drawable_chunks);
+	RL_FREE(occluders);
+	RL_FREE(drawable_sides);
+	RL_FREE(visible_order);
+	RL_FREE(visible_order_scratch);
 }
 
 void terrain_update() { terrain_update_chunks(); }
 
+static Shader terrain_load_shader()
+{
+	static const char* vertex_path = "assets/materials/basic_lit.vert";
+	static const char* fragment_path = "assets/materials/basic_lit.frag";
+#if TERRAIN_BAKED_LIGHTING
+	char* vertex = shader_source_read(vertex_path, "BAKED_LIGHTING");
+	char* fragment = shader_source_read(fragment_path, "BAKED_LIGHTING");
+	Shader shader = shader_cache_load_from_memory(vertex, fragment);
+	RL_FREE(vertex);
+	RL_FREE(fragment);
+
+	// in the same order as the shader's faceLights, +x -x +y -y +z -z
+	const Color tint = terrain_mat.maps[MATERIAL_MAP_DIFFUSE].color;
+	const Vector4 tint_normalized = ColorNormalize(tint);
+	Vector4 face_lights[6];
+	for (uint8_t i = 0; i < 6; ++i) {
+		const float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+		const Vector3 normal = {
+			(i / 2 == 0) ? sign : 0,
+			(i / 2 == 1) ? sign : 0,
+			(i / 2 == 2) ? sign : 0,
+		};
+		const Vector3 light = scene_uniforms_get_diffuse(normal);
+		face_lights[i] = (Vector4){
+			light.x * tint_normalized.x,
+			light.y * tint_normalized.y,
+			light.z * tint_normalized.z,
+			tint_normalized.w,
+		};
+	}
+	SetShaderValueV(shader, GetShaderLocation(shader, "faceLights"),
+					face_lights, SHADER_UNIFORM_VEC4, 6);
+	return shader;
+#else
+	return shader_cache_load(vertex_path, fragment_path);
+#endif
+}
+
 /// NOTE: this is multithreaded in that we can load multiple chunks at the same
 /// time. however there is not a separate terrain thread, meaning we have to
 /// wait for all the loading jobs to finish before terrain_update completes.
@@ -170,15 +391,20 @@ static void terrain_update_chunks()
 	}
 
 	// for each plane, add 1 to nearby chunks or load them if they don't exist.
+	const double start_time = GetTime();
+	const TerrainBufferStats buffer_stats_before =
+		terrain_render_get_buffer_stats();
+	size_t chunks_added_per_lod[TERRAIN_LOD_COUNT] = {0};
 	for (uint8_t plane_index = 0; plane_index < NUM_PLANES; ++plane_index) {
 		size_t chunks_added = 0;
-		ChunkCoords player_location = {
-			.x = (chunk_index_t)(player_positions[plane_index].coords.x /
-								 CHUNK_SIZE),
-			.z = (chunk_index_t)(player_positions[plane_index].coords.z /
-								 CHUNK_SIZE),
-		};
+		ChunkCoords player_location = terrain_player_chunk(plane_index);
 		ChunkCoords chunk_location;
+		voxel_regions[plane_index] = (Vector4){
+			(float)((player_location.x - RENDER_DISTANCE_HALF) * CHUNK_SIZE),
+			(float)((player_location.z - RENDER_DISTANCE_HALF) * CHUNK_SIZE),
+			(float)((player_location.x + RENDER_DISTANCE_HALF) * CHUNK_SIZE),
+			(float)((player_location.z + RENDER_DISTANCE_HALF) * CHUNK_SIZE),
+		};
 
 		// annoyingly complex looking for loop to go through all the chunk
 		// coordinates that the player wants to load
@@ -209,10 +435,12 @@ static void terrain_update_chunks()
 					continue;
 				}
 
+				const uint8_t lod = terrain_chunk_lod(chunk_location);
 				Chunk out;
-				terrain_generate_mesh_for_chunk(chunk_location, &out);
+				terrain_generate_mesh_for_chunk(chunk_location, lod, &out);
 				terrain_mesh_insert(terrain_data, &out);
 				++chunks_added;
+				++chunks_added_per_lod[lod];
 			}
 		}
 		TraceLog(LOG_INFO, "added %d chunks", chunks_added);
@@ -242,59 +470,186 @@ static void terrain_update_chunks()
 	terrain_data_normalize(terrain_data);
 	assert(terrain_data->available_indices->count == 0);
 
+	const size_t remeshed = terrain_update_chunk_lods();
+
 	TraceLog(LOG_DEBUG, "Created %d chunk meshes", terrain_data->count);
+	for (uint8_t lod = 0; lod < TERRAIN_LOD_COUNT; ++lod) {
+		TraceLog(LOG_DEBUG, "added %zu chunks at LOD %d",
+				 chunks_added_per_lod[lod], lod);
+	}
+	TraceLog(LOG_DEBUG, "remeshed %zu chunks for LOD, took %f ms total",
+			 remeshed, (GetTime() - start_time) * 1000.0);
+	// once streaming has settled, every upload should land in a recycled range
+	// and this should stay at 0
+	const TerrainBufferStats buffer_stats = terrain_render_get_buffer_stats();
+	TraceLog(LOG_DEBUG,
+			 "terrain uploads: %zu recycled, %zu carved, %zu driver "
+			 "allocations",
+			 buffer_stats.recycled - buffer_stats_before.recycled,
+			 buffer_stats.carved - buffer_stats_before.carved,
+			 buffer_stats.driver_allocations -
+				 buffer_stats_before.driver_allocations);
+}
+
+static ChunkCoords terrain_player_chunk(uint8_t plane_index)
+{
+	return (ChunkCoords){
+		.x = (chunk_index_t)(player_positions[plane_index].coords.x /
+							 CHUNK_SIZE),
+		.z = (chunk_index_t)(player_positions[plane_index].coords.z /
+							 CHUNK_SIZE),
+	};
+}
+
+static uint8_t terrain_chunk_facing_sides(const Chunk* chunk,
+										  Vector3 camera_position,
+										  TerrainDrawStats* stats)
+{
+	// every face of a side lies somewhere inside the chunk's bounds, so if the
+	// camera is behind the bounds relative to that side, so are all its faces
+	const BoundingBox* bounds = &chunk->bounds;
+	const bool facing[NUM_SIDES] = {
+		[SOUTH] = camera_position.z > bounds->min.z,
+		[NORTH] = camera_position.z < bounds->max.z,
+		[WEST] = camera_position.x > bounds->min.x,
+		[EAST] = camera_position.x < bounds->max.x,
+		[UP] = camera_position.y > bounds->min.y,
+		[DOWN] = camera_position.y < bounds->max.y,
+	};
+
+	uint8_t sides = 0;
+	for (uint8_t i = 0; i < NUM_SIDES; ++i) {
+		const uint32_t triangles = chunk->side_vertices[i] / 3;
+		if (facing[i]) {
+			sides |= 1 << i;
+			stats->triangles += triangles;
+		} else {
+			stats->backface_triangles += triangles;
+		}
+	}
+	return sides;
+}
+
+static size_t terrain_chunk_add_sides(const Chunk* chunk, uint8_t sides,
+									  size_t count)
+{
+	uint32_t first = chunk->range.first;
+	bool extend_last = false;
+	for (uint8_t i = 0; i < NUM_SIDES; ++i) {
+		const uint32_t vertices = chunk->side_vertices[i];
+		if (vertices == 0) {
+			continue;
+		}
+		if (!(sides & (1 << i))) {
+			extend_last = false;
+		} else if (extend_last) {
+			// sides are stored back to back, draw neighbors as one range
+			visible_ranges[count - 1].count += vertices;
+		} else {
+			visible_ranges[count] = (TerrainMeshRange){
+				.first = first,
+				.count = vertices,
+			};
+			++count;
+			extend_last = true;
+		}
+		first += vertices;
+	}
+	assert(first == chunk->range.first + chunk->range.count);
+	return count;
+}
+
+static uint8_t terrain_chunk_lod(ChunkCoords chunk_coords)
+{
+	// chebyshev distance, in chunks, to the closest plane
+	int distance = INT_MAX;
+	for (uint8_t i = 0; i < NUM_PLANES; ++i) {
+		const ChunkCoords player = terrain_player_chunk(i);
+		const int dx = abs((int)chunk_coords.x - (int)player.x);
+		const int dz = abs((int)chunk_coords.z - (int)player.z);
+		const int plane_distance = dx > dz ? dx : dz;
+		if (plane_distance < distance) {
+			distance = plane_distance;
+		}
+	}
+
+	if (distance < TERRAIN_LOD_RADIUS) {
+		return 0;
+	}
+	if (distance < TERRAIN_LOD_RADIUS + TERRAIN_LOD_BAND) {
+		return 1;
+	}
+	return TERRAIN_LOD_COUNT - 1;
+}
+
+static size_t terrain_update_chunk_lods()
+{
+	size_t remeshed = 0;
+	for (size_t i = 0; i < terrain_data->count; ++i) {
+		Chunk* chunk = &terrain_data->chunks[i];
+		const uint8_t lod = terrain_chunk_lod(chunk->position);
+		if (lod == chunk->lod) {
+			continue;
+		}
+		// give the old vertices back first so the new ones can go in the
+		// same spot if they fit
+		terrain_render_free(&chunk->range);
+		terrain_generate_mesh_for_chunk(chunk->position, lod, chunk);
+		++remeshed;
+	}
+	return remeshed;
 }
 
+/// Voxelize and mesh a chunk, then upload it into the shared terrain buffer.
 static void terrain_generate_mesh_for_chunk(ChunkCoords chunk_coords,
-											Chunk* out_chunk)
+											uint8_t lod, Chunk* out_chunk)
 {
 	voxel_data->coords = chunk_coords;
+	voxel_data->lod = lod;
 	terrain_voxel_data_generate(voxel_data);
 	// voxels are now filled with the correct block_t values, meshing
 	// time
 	Mesher mesher;
 	mesher_create(&mesher);
+	mesher_use_staging(&mesher);
 	// pass number of faces into "quads" argument of allocate, since all
 	// the faces are quads (these are cubes)
-	size_t faces = terrain_voxel_data_get_face_count(voxel_data);
-	mesher_allocate(&mesher, faces);
+	// one region per side, so each side can be skipped when drawing
+	size_t faces[NUM_SIDES];
+	terrain_voxel_data_get_face_counts(voxel_data, faces);
+	const float solid_height =
+		(float)terrain_voxel_data_get_solid_height(voxel_data);
+	mesher_allocate_regions(&mesher, faces, NUM_SIDES);
 	terrain_voxel_data_populate_mesher(voxel_data, &mesher);
-	Mesh mesh = mesher_release(&mesher);
-
-	{
-		Mesh* available_mesh = NULL;
-
-		// if there is a mesh available, just use its VAO and VBO etc
-		if (terrain_data->available_indices->count > 0) {
-			available_mesh =
-				&terrain_data
-					 ->chunks[terrain_data->available_indices->indices
-								  [terrain_data->available_indices->count - 1]]
-					 .mesh;
-		}
-
-		UploadTerrainMesh(&mesh, available_mesh, false);
-
-		// set the mesh's VAO and VBOs to 0 so they dont get cleared on unload
-		// (we are now using those handles)
-		if (available_mesh) {
-			terrain_render_clear_mesh(available_mesh);
-		}
+	for (uint8_t i = 0; i < NUM_SIDES; ++i) {
+		size_t first_vertex;
+		size_t vertex_count;
+		mesher_get_region(&mesher, i, &first_vertex, &vertex_count);
+		out_chunk->side_vertices[i] = (uint32_t)vertex_count;
 	}
-
-	// mesh is now on the GPU, go ahead and free the cpu parts
-	RL_FREE(mesh.vertices);
-	RL_FREE(mesh.texcoords);
-	RL_FREE(mesh.normals);
+	// vertices are already in world space, so are the bounds
+	const BoundingBox bounds = mesher.bounds;
+	const Vector3 chunk_min = {(float)(chunk_coords.x * CHUNK_SIZE), 0,
+							   (float)(chunk_coords.z * CHUNK_SIZE)};
+	const BoundingBox occluder = {
+		.min = chunk_min,
+		.max = Vector3Add(chunk_min,
+						  (Vector3){CHUNK_SIZE, solid_height, CHUNK_SIZE}),
+	};
+	const StagingRange staged = mesher.staging;
+	Mesh mesh = mesher_release(&mesher);
 	assert(mesh.texcoords2 == NULL);
 	assert(mesh.colors == NULL);
-	mesh.vertices = NULL;
-	mesh.normals = NULL;
-	mesh.texcoords = NULL;
-	mesh.indices = NULL;
 
-	// mesh has been modified to contain handles from the opengl context
-	// send it to the output
+	const TerrainMeshRange range = terrain_render_upload(&mesh, &staged);
+
+	// mesh is now on the GPU (or being copied there out of the staging
+	// ring), the cpu parts can be reused for the next chunk
+	mesher_scratch_reset();
+
 	out_chunk->position = chunk_coords;
-	out_chunk->mesh = mesh;
+	out_chunk->lod = lod;
+	out_chunk->bounds = bounds;
+	out_chunk->occluder = occluder;
+	out_chunk->range = range;
 }
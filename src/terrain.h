@@ -1,8 +1,44 @@
 #pragma once
+#include "render_pipeline.h"
 #include <raylib.h>
+#include <stddef.h>
 #include <stdint.h>
 
-void terrain_draw();
+/// How much of the terrain made it to the GPU for one view
+typedef struct
+{
+	/// chunks submitted with a draw call
+	size_t drawn;
+	/// chunks skipped because they were outside the view frustum
+	size_t culled;
+	/// chunks skipped because they were hidden behind other chunks
+	size_t occluded;
+	/// triangles submitted for the chunks which were drawn
+	size_t triangles;
+	/// triangles of drawn chunks left out because their whole side of the
+	/// chunk faced away from the camera
+	size_t backface_triangles;
+	/// time spent deciding which chunks to draw, in milliseconds
+	double cull_ms;
+} TerrainDrawStats;
+
+/// Gather the per-frame chunk lists which don't depend on the camera. Call once
+/// per frame, after terrain_update and before any terrain_draw.
+void terrain_prepare();
+
+/// Queue all loaded chunks which are visible from any of the given views, front
+/// to back, as one draw call instanced for each view.
+/// @param view_count: number no greater than MAX_VIEWS
+void terrain_draw(const RenderView* views, uint8_t view_count);
+
+/// Queue the low detail terrain past the loaded chunks.
+void terrain_draw_distant(const RenderView* view);
+
+/// Get the stats recorded the last time terrain_draw was called with a view.
+/// When views are drawn together, triangles counts what that view can see,
+/// not everything which was drawn.
+/// @param view_index: number less than MAX_VIEWS
+TerrainDrawStats terrain_get_draw_stats(uint8_t view_index);
 
 /// Potentially load new chunks and unload old ones.
 void terrain_update();
@@ -0,0 +1,334 @@
+#include "terrain_clipmap.h"
+#include "terrain_internal.h"
+#include "gpu_timer.h"
+#include "render_queue.h"
+#include "scene_uniforms.h"
+#include "shader_cache.h"
+#include <math.h>
+#include <raymath.h>
+#include <rlgl.h>
+#include <stdlib.h>
+
+typedef struct
+{
+	/// false until the first time the level is filled with heights
+	bool valid;
+	/// world position of the first sample in the grid, in units of this
+	/// level's spacing
+	int origin_x;
+	int origin_z;
+} ClipmapLevel;
+
+/// The heights around one plane. Each level is a CLIPMAP_SIZE square of the
+/// heightmap texture, levels are stacked on top of each other. Samples are
+/// stored toroidally: a world sample always lives at the texel of its
+/// position modulo CLIPMAP_SIZE, so moving the grid only overwrites the rows
+/// and columns that scrolled in.
+typedef struct
+{
+	ClipmapLevel levels[CLIPMAP_LEVELS];
+	Texture heightmap;
+} PlaneClipmap;
+
+typedef struct
+{
+	int level;
+	int size;
+	int origin;
+	int spacing;
+	int inner_region;
+	int voxel_regions;
+} ClipmapShaderLocs;
+
+static PlaneClipmap clipmaps[NUM_PLANES];
+static Mesh grid;
+static Material clipmap_mat;
+static ClipmapShaderLocs locs;
+// one level worth of heights, staged before being sent to the texture
+static float upload_scratch[CLIPMAP_SIZE * CLIPMAP_SIZE];
+/// the regions passed to the last terrain_clipmap_draw, left out when the
+/// queued draw happens
+static const Vector4* queued_voxel_regions;
+
+static float terrain_clipmap_spacing(uint8_t level);
+static int terrain_clipmap_wrap(int cell);
+static float terrain_clipmap_sample(uint8_t level, int cell_x, int cell_z);
+static void terrain_clipmap_fill_level(PlaneClipmap* clipmap, uint8_t level);
+static void terrain_clipmap_fill_column(PlaneClipmap* clipmap, uint8_t level,
+										int cell_x);
+static void terrain_clipmap_fill_row(PlaneClipmap* clipmap, uint8_t level,
+									 int cell_z);
+/// World-space xz rectangle covered by a level, as (min x, min z, max x, max z)
+static Vector4 terrain_clipmap_level_region(const ClipmapLevel* level_state,
+											uint8_t level);
+static Mesh terrain_clipmap_generate_grid();
+/// Draw every level of a view's clipmap, given the view.
+static void terrain_clipmap_draw_queued(const void* data);
+
+void terrain_clipmap_load()
+{
+	grid = terrain_clipmap_generate_grid();
+
+	clipmap_mat = LoadMaterialDefault();
+	clipmap_mat.maps[MATERIAL_MAP_DIFFUSE].color = WHITE;
+	Shader shader = shader_cache_load("assets/materials/clipmap.vert",
+									  "assets/materials/clipmap.frag");
+	locs = (ClipmapShaderLocs){
+		.level = GetShaderLocation(shader, "level"),
+		.size = GetShaderLocation(shader, "size"),
+		.origin = GetShaderLocation(shader, "origin"),
+		.spacing = GetShaderLocation(shader, "spacing"),
+		.inner_region = GetShaderLocation(shader, "innerRegion"),
+		.voxel_regions = GetShaderLocation(shader, "voxelRegions"),
+	};
+	const int size = CLIPMAP_SIZE;
+	SetShaderValue(shader, locs.size, &size, SHADER_UNIFORM_INT);
+	scene_uniforms_bind_shader(shader);
+	clipmap_mat.shader = shader;
+
+	for (uint8_t i = 0; i < NUM_PLANES; ++i) {
+		clipmaps[i] = (PlaneClipmap){
+			.heightmap =
+				{
+					.id = rlLoadTexture(NULL, CLIPMAP_SIZE,
+										CLIPMAP_SIZE * CLIPMAP_LEVELS,
+										PIXELFORMAT_UNCOMPRESSED_R32, 1),
+					.width = CLIPMAP_SIZE,
+					.height = CLIPMAP_SIZE * CLIPMAP_LEVELS,
+					.mipmaps = 1,
+					.format = PIXELFORMAT_UNCOMPRESSED_R32,
+				},
+		};
+		if (clipmaps[i].heightmap.id == 0) {
+			TraceLog(LOG_WARNING,
+					 "Failed to create clipmap heightmap, float textures "
+					 "may be unsupported");
+		}
+	}
+}
+
+void terrain_clipmap_cleanup()
+{
+	for (uint8_t i = 0; i < NUM_PLANES; ++i) {
+		rlUnloadTexture(clipmaps[i].heightmap.id);
+	}
+	// the material doesn't own any of the heightmaps, dont let it unload them
+	clipmap_mat.maps[MATERIAL_MAP_DIFFUSE].texture = (Texture){0};
+	UnloadMaterial(clipmap_mat);
+	UnloadMesh(grid);
+}
+
+void terrain_clipmap_update_player_pos(uint8_t index, Vector3 pos)
+{
+	assert(index < NUM_PLANES);
+	PlaneClipmap* clipmap = &clipmaps[index];
+
+	for (uint8_t level = 0; level < CLIPMAP_LEVELS; ++level) {
+		ClipmapLevel* state = &clipmap->levels[level];
+		const float spacing = terrain_clipmap_spacing(level);
+		const int origin_x =
+			(int)floorf(pos.x / spacing) - (CLIPMAP_SIZE / 2);
+		const int origin_z =
+			(int)floorf(pos.z / spacing) - (CLIPMAP_SIZE / 2);
+		const int delta_x = origin_x - state->origin_x;
+		const int delta_z = origin_z - state->origin_z;
+
+		if (!state->valid || abs(delta_x) >= CLIPMAP_SIZE ||
+			abs(delta_z) >= CLIPMAP_SIZE) {
+			// nothing on the grid can be kept, start over
+			state->valid = true;
+			state->origin_x = origin_x;
+			state->origin_z = origin_z;
+			terrain_clipmap_fill_level(clipmap, level);
+			continue;
+		}
+
+		const int old_x = state->origin_x;
+		const int old_z = state->origin_z;
+		state->origin_x = origin_x;
+		state->origin_z = origin_z;
+
+		// columns which scrolled in along x. empty range if we didnt move
+		const int first_x = delta_x > 0 ? old_x + CLIPMAP_SIZE : origin_x;
+		const int end_x = delta_x > 0 ? origin_x + CLIPMAP_SIZE : old_x;
+		for (int x = first_x; x < end_x; ++x) {
+			terrain_clipmap_fill_column(clipmap, level, x);
+		}
+
+		// and rows along z. the corner where they overlap gets sampled twice,
+		// but it is at most a few samples
+		const int first_z = delta_z > 0 ? old_z + CLIPMAP_SIZE : origin_z;
+		const int end_z = delta_z > 0 ? origin_z + CLIPMAP_SIZE : old_z;
+		for (int z = first_z; z < end_z; ++z) {
+			terrain_clipmap_fill_row(clipmap, level, z);
+		}
+	}
+}
+
+void terrain_clipmap_draw(const RenderView* view,
+						  const Vector4 voxel_regions[NUM_PLANES])
+{
+	assert(view->plane < NUM_PLANES);
+	queued_voxel_regions = voxel_regions;
+	render_queue_push(&(RenderCommand){
+		.pass = RENDER_PASS_DISTANT,
+		.shader = clipmap_mat.shader.id,
+		.texture = clipmaps[view->plane].heightmap.id,
+		.vao = grid.vaoId,
+		.draw = terrain_clipmap_draw_queued,
+		.data = view,
+	});
+}
+
+static void terrain_clipmap_draw_queued(const void* data)
+{
+	const RenderView* view = data;
+	const PlaneClipmap* clipmap = &clipmaps[view->plane];
+	const Shader shader = clipmap_mat.shader;
+	gpu_timer_begin(GPU_TIMER_DISTANT_TERRAIN);
+
+	clipmap_mat.maps[MATERIAL_MAP_DIFFUSE].texture = clipmap->heightmap;
+	SetShaderValueV(shader, locs.voxel_regions, queued_voxel_regions,
+					SHADER_UNIFORM_VEC4, NUM_PLANES);
+
+	// level 0 fills all the way up to the voxel terrain, every level after
+	// that is cut out where the level inside of it already drew
+	Vector4 inner_region = {0};
+	for (uint8_t level = 0; level < CLIPMAP_LEVELS; ++level) {
+		const ClipmapLevel* state = &clipmap->levels[level];
+		if (!state->valid) {
+			break;
+		}
+		const int level_int = level;
+		const int origin[2] = {state->origin_x, state->origin_z};
+		const float spacing = terrain_clipmap_spacing(level);
+		SetShaderValue(shader, locs.level, &level_int, SHADER_UNIFORM_INT);
+		SetShaderValue(shader, locs.origin, origin, SHADER_UNIFORM_IVEC2);
+		SetShaderValue(shader, locs.spacing, &spacing, SHADER_UNIFORM_FLOAT);
+		SetShaderValue(shader, locs.inner_region, &inner_region,
+					   SHADER_UNIFORM_VEC4);
+		DrawMesh(grid, clipmap_mat, MatrixIdentity());
+		inner_region = terrain_clipmap_level_region(state, level);
+	}
+	gpu_timer_end(GPU_TIMER_DISTANT_TERRAIN);
+}
+
+static float terrain_clipmap_spacing(uint8_t level)
+{
+	return (float)(CLIPMAP_BASE_SPACING << level);
+}
+
+static int terrain_clipmap_wrap(int cell)
+{
+	const int wrapped = cell % CLIPMAP_SIZE;
+	return wrapped < 0 ? wrapped + CLIPMAP_SIZE : wrapped;
+}
+
+static float terrain_clipmap_sample(uint8_t level, int cell_x, int cell_z)
+{
+	const float spacing = terrain_clipmap_spacing(level);
+	// samples are at least CLIPMAP_BASE_SPACING apart, the octaves dropped
+	// for the lowest voxel level of detail are too fine to show up anyways
+	return terrain_sample_surface_height((float)cell_x * spacing,
+										 (float)cell_z * spacing,
+										 TERRAIN_LOD_COUNT - 1);
+}
+
+static void terrain_clipmap_fill_level(PlaneClipmap* clipmap, uint8_t level)
+{
+	const ClipmapLevel* state = &clipmap->levels[level];
+	for (int z = state->origin_z; z < state->origin_z + CLIPMAP_SIZE; ++z) {
+		for (int x = state->origin_x; x < state->origin_x + CLIPMAP_SIZE;
+			 ++x) {
+			upload_scratch[(terrain_clipmap_wrap(z) * CLIPMAP_SIZE) +
+						   terrain_clipmap_wrap(x)] =
+				terrain_clipmap_sample(level, x, z);
+		}
+	}
+	rlUpdateTexture(clipmap->heightmap.id, 0, level * CLIPMAP_SIZE,
+					CLIPMAP_SIZE, CLIPMAP_SIZE, PIXELFORMAT_UNCOMPRESSED_R32,
+					upload_scratch);
+}
+
+static void terrain_clipmap_fill_column(PlaneClipmap* clipmap, uint8_t level,
+										int cell_x)
+{
+	const ClipmapLevel* state = &clipmap->levels[level];
+	// the column is one texel wide, so it is contiguous once staged
+	for (int z = state->origin_z; z < state->origin_z + CLIPMAP_SIZE; ++z) {
+		upload_scratch[terrain_clipmap_wrap(z)] =
+			terrain_clipmap_sample(level, cell_x, z);
+	}
+	rlUpdateTexture(clipmap->heightmap.id, terrain_clipmap_wrap(cell_x),
+					level * CLIPMAP_SIZE, 1, CLIPMAP_SIZE,
+					PIXELFORMAT_UNCOMPRESSED_R32, upload_scratch);
+}
+
+static void terrain_clipmap_fill_row(PlaneClipmap* clipmap, uint8_t level,
+									 int cell_z)
+{
+	const ClipmapLevel* state = &clipmap->levels[level];
+	for (int x = state->origin_x; x < state->origin_x + CLIPMAP_SIZE; ++x) {
+		upload_scratch[terrain_clipmap_wrap(x)] =
+			terrain_clipmap_sample(level, x, cell_z);
+	}
+	rlUpdateTexture(clipmap->heightmap.id, 0,
+					(level * CLIPMAP_SIZE) + terrain_clipmap_wrap(cell_z),
+					CLIPMAP_SIZE, 1, PIXELFORMAT_UNCOMPRESSED_R32,
+					upload_scratch);
+}
+
+static Vector4 terrain_clipmap_level_region(const ClipmapLevel* level_state,
+											uint8_t level)
+{
+	const float spacing = terrain_clipmap_spacing(level);
+	// the grid has CLIPMAP_SIZE samples, so one less cell
+	const float extent = (float)(CLIPMAP_SIZE - 1) * spacing;
+	const float min_x = (float)level_state->origin_x * spacing;
+	const float min_z = (float)level_state->origin_z * spacing;
+	return (Vector4){min_x, min_z, min_x + extent, min_z + extent};
+}
+
+/// A flat CLIPMAP_SIZE square grid of vertices, one unit apart. The clipmap
+/// vertex shader moves and displaces it for each level.
+static Mesh terrain_clipmap_generate_grid()
+{
+	Mesh mesh = {0};
+	mesh.vertexCount = CLIPMAP_SIZE * CLIPMAP_SIZE;
+	mesh.triangleCount = (CLIPMAP_SIZE - 1) * (CLIPMAP_SIZE - 1) * 2;
+	static_assert(CLIPMAP_SIZE * CLIPMAP_SIZE <= UINT16_MAX,
+				  "Clipmap grid too large for 16 bit indices");
+	mesh.vertices = RL_CALLOC(mesh.vertexCount * 3, sizeof(float));
+	mesh.indices =
+		RL_CALLOC(mesh.triangleCount * 3, sizeof(mesh.indices[0]));
+
+	for (int z = 0; z < CLIPMAP_SIZE; ++z) {
+		for (int x = 0; x < CLIPMAP_SIZE; ++x) {
+			float* vertex = &mesh.vertices[((z * CLIPMAP_SIZE) + x) * 3];
+			vertex[0] = (float)x;
+			vertex[1] = 0;
+			vertex[2] = (float)z;
+		}
+	}
+
+	size_t index = 0;
+	for (int z = 0; z < CLIPMAP_SIZE - 1; ++z) {
+		for (int x = 0; x < CLIPMAP_SIZE - 1; ++x) {
+			const unsigned short top_left = (z * CLIPMAP_SIZE) + x;
+			const unsigned short top_right = top_left + 1;
+			const unsigned short bottom_left = top_left + CLIPMAP_SIZE;
+			const unsigned short bottom_right = bottom_left + 1;
+			// counter-clockwise when seen from above
+			mesh.indices[index++] = top_left;
+			mesh.indices[index++] = bottom_left;
+			mesh.indices[index++] = top_right;
+			mesh.indices[index++] = top_right;
+			mesh.indices[index++] = bottom_left;
+			mesh.indices[index++] = bottom_right;
+		}
+	}
+	assert(index == (size_t)mesh.triangleCount * 3);
+
+	UploadMesh(&mesh, false);
+	return mesh;
+}
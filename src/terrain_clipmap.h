@@ -0,0 +1,33 @@
+#pragma once
+#include "constants/general.h"
+#include "render_pipeline.h"
+#include <assert.h>
+#include <raylib.h>
+#include <stdint.h>
+
+/// Number of nested rings of heightmap terrain around each plane. Each level
+/// covers twice the distance of the one inside it at half the resolution.
+#define CLIPMAP_LEVELS 3
+/// Number of height samples along one side of a level.
+#define CLIPMAP_SIZE 64
+/// Distance in world units between samples of the innermost level.
+#define CLIPMAP_BASE_SPACING 4
+static_assert((CLIPMAP_SIZE % 2) == 0, "Clipmap size must be even");
+
+/// Load the clipmap grid mesh, shader, and per-plane height textures. Must be
+/// called after init_noise.
+void terrain_clipmap_load();
+
+/// Recenter a plane's clipmap on its position. Only samples and uploads the
+/// rows and columns of heights that scrolled into view since last time.
+/// @param index: number less than NUM_PLANES
+void terrain_clipmap_update_player_pos(uint8_t index, Vector3 pos);
+
+/// Queue the clipmap of the plane that a view belongs to. Anything inside one
+/// of the voxel_regions is left out, since voxel chunks are drawn there.
+/// @param voxel_regions: world-space xz rectangles, one per plane, stored as
+/// (min x, min z, max x, max z). Must stay valid until the queue is flushed
+void terrain_clipmap_draw(const RenderView* view,
+						  const Vector4 voxel_regions[NUM_PLANES]);
+
+void terrain_clipmap_cleanup();
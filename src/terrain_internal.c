@@ -1,10 +1,13 @@
 #include "terrain_internal.h"
 #include "quicksort.h"
+#include "terrain_render.h"
 #include "threadutils.h"
 #include <FastNoiseLite.h>
 #include <raymath.h>
 
 #define MAX_INTERP_POINTS 6
+// how many fewer noise octaves to sample at each successive level of detail
+#define TERRAIN_LOD_OCTAVE_DROP 2
 // a struct defining basically a piecewise function on which to transform
 // noise after sampling.
 typedef struct
@@ -16,11 +19,14 @@ typedef struct
 typedef struct
 {
 	fnl_state settings;
+	/// copies of settings with fewer octaves, indexed by level of detail
+	fnl_state lod_settings[TERRAIN_LOD_COUNT];
 	InterpPoints transform;
 	float transform_scale;
 } NoiseLayer;
 
 static fnl_state terrain_noise_perlin_main;
+static fnl_state terrain_noise_perlin_main_lod[TERRAIN_LOD_COUNT];
 
 // continentialness
 static NoiseLayer terrain_noise_height_base;
@@ -43,6 +49,8 @@ static void terrain_interp_add_point(InterpPoints* points, Vector2 point);
 static float terrain_interp_transform(const InterpPoints* points, float input);
 static void terrain_interp_create(InterpPoints* points, float left,
 								  float right);
+static void terrain_noise_build_lods(const fnl_state* settings,
+									 fnl_state lods[TERRAIN_LOD_COUNT]);
 static float perlin_3d(const fnl_state* noise, float x, float y, float z);
 static float perlin_2d(const fnl_state* noise, float x, float y);
 
@@ -85,35 +93,56 @@ void init_noise()
 	terrain_noise_height_detail.settings.octaves = 2;
 	terrain_noise_height_detail.settings.noise_type = FNL_NOISE_PERLIN;
 	terrain_noise_height_detail.settings.lacunarity = 1;
+
+	terrain_noise_build_lods(&terrain_noise_perlin_main,
+							 terrain_noise_perlin_main_lod);
+	terrain_noise_build_lods(&terrain_noise_height_base.settings,
+							 terrain_noise_height_base.lod_settings);
+	terrain_noise_build_lods(&terrain_noise_height_detail.settings,
+							 terrain_noise_height_detail.lod_settings);
 }
 
-block_t terrain_generate_voxel(ChunkCoords chunk, VoxelCoords voxel)
+/// Distant chunks are made of large voxels which can't show fine detail
+/// anyways, so don't pay for the high frequency octaves there.
+static void terrain_noise_build_lods(const fnl_state* settings,
+									 fnl_state lods[TERRAIN_LOD_COUNT])
 {
-	float x = (float)voxel.x + (float)(chunk.x * max_voxelcoord.x);
-	float y = (float)voxel.y;
-	float z = (float)voxel.z + (float)(chunk.z * max_voxelcoord.z);
-
-	// both values between -1 and 1
-	const float base_height_generated =
-		perlin_2d(&terrain_noise_height_base.settings, x, z);
-
-	const float base_height =
-		terrain_interp_transform(&terrain_noise_height_base.transform,
-								 Clamp(base_height_generated, -1, 1)) *
-		terrain_noise_height_base.transform_scale;
+	for (uint8_t lod = 0; lod < TERRAIN_LOD_COUNT; ++lod) {
+		lods[lod] = *settings;
+		const int octaves =
+			settings->octaves - (lod * TERRAIN_LOD_OCTAVE_DROP);
+		lods[lod].octaves = octaves < 1 ? 1 : octaves;
+	}
+}
 
-	const float detail_height_generated =
-		perlin_2d(&terrain_noise_height_detail.settings, x, z);
-	const float detail_height =
-		terrain_interp_transform(&terrain_noise_height_detail.transform,
-								 Clamp(detail_height_generated, -1, 1)) *
-		terrain_noise_height_detail.transform_scale;
+VoxelCoords terrain_lod_dimensions(uint8_t lod)
+{
+	assert(lod < TERRAIN_LOD_COUNT);
+	return (VoxelCoords){
+		.x = max_voxelcoord.x >> lod,
+		.y = max_voxelcoord.y >> lod,
+		.z = max_voxelcoord.z >> lod,
+	};
+}
 
-	const float height = Clamp(terrain_height + base_height + detail_height, 0,
-							   WORLD_HEIGHT - 1);
+block_t terrain_generate_voxel(ChunkCoords chunk, VoxelCoords voxel,
+							   uint8_t lod)
+{
+	assert(lod < TERRAIN_LOD_COUNT);
+	// sample in the middle of large voxels. works out to 0 at full detail
+	const uint16_t step = 1 << lod;
+	const float center = (float)(step - 1) * 0.5f;
+	float x = (float)(voxel.x * step) + center +
+			  (float)(chunk.x * max_voxelcoord.x);
+	float y = (float)(voxel.y * step) + center;
+	float z = (float)(voxel.z * step) + center +
+			  (float)(chunk.z * max_voxelcoord.z);
+
+	const float height = terrain_sample_surface_height(x, z, lod);
 
 	// value between -1 and 1
-	const float density = perlin_3d(&terrain_noise_perlin_main, x, y, z);
+	const float density =
+		perlin_3d(&terrain_noise_perlin_main_lod[lod], x, y, z);
 	const float final = Clamp(((y - height) / WORLD_HEIGHT) + density, -1, 1);
 	// TraceLog(LOG_INFO,
 	// 		 "BASE HEIGHT: %f\nDETAIL HEIGHT: %f\nHEIGHT: %f\nDENSITY: "
@@ -127,6 +156,29 @@ block_t terrain_generate_voxel(ChunkCoords chunk, VoxelCoords voxel)
 	return 0;
 }
 
+float terrain_sample_surface_height(float x, float z, uint8_t lod)
+{
+	assert(lod < TERRAIN_LOD_COUNT);
+	// both values between -1 and 1
+	const float base_height_generated =
+		perlin_2d(&terrain_noise_height_base.lod_settings[lod], x, z);
+
+	const float base_height =
+		terrain_interp_transform(&terrain_noise_height_base.transform,
+								 Clamp(base_height_generated, -1, 1)) *
+		terrain_noise_height_base.transform_scale;
+
+	const float detail_height_generated =
+		perlin_2d(&terrain_noise_height_detail.lod_settings[lod], x, z);
+	const float detail_height =
+		terrain_interp_transform(&terrain_noise_height_detail.transform,
+								 Clamp(detail_height_generated, -1, 1)) *
+		terrain_noise_height_detail.transform_scale;
+
+	return Clamp(terrain_height + base_height + detail_height, 0,
+				 WORLD_HEIGHT - 1);
+}
+
 static float perlin_3d(const fnl_state* noise, float x, float y, float z)
 {
 	float gen = fnlGetNoise3D(noise, x, y, z);
@@ -183,7 +235,7 @@ size_t terrain_mesh_insert(TerrainData* restrict data, const Chunk* new_chunk)
 		index = data->available_indices
 					->indices[data->available_indices->count - 1];
 		--data->available_indices->count;
-		UnloadMesh(data->chunks[index].mesh);
+		terrain_render_free(&data->chunks[index].range);
 	}
 	data->chunks[index] = *new_chunk;
 	return index;
@@ -234,7 +286,7 @@ void terrain_data_normalize(TerrainData* data)
 			continue;
 		}
 		// otherwise, we can move this one
-		UnloadMesh(data->chunks[available].mesh);
+		terrain_render_free(&data->chunks[available].range);
 		data->chunks[available] = data->chunks[data->count - 1];
 		--data->count;
 	}
@@ -247,31 +299,37 @@ bool terrain_voxel_is_solid(block_t type) { return type != 0; }
 
 void terrain_mesher_add_face(Mesher* restrict mesher,
 							 const Vector3* restrict position,
-							 const VoxelFaceInfo* restrict face)
+							 const VoxelFaceInfo* restrict face, float scale)
 {
 	mesher->normal = face->normal;
 	for (uint8_t i = 0; i < NUM_SIDES; ++i) {
 		mesher->uv = face->vertex_infos[i].uv;
-		mesher_push_vertex(mesher, &face->vertex_infos[i].offset, position);
+		const Vector3 offset =
+			Vector3Scale(face->vertex_infos[i].offset, scale);
+		mesher_push_vertex(mesher, &offset, position);
 	}
 }
 
 void terrain_add_voxel_to_mesher(Mesher* restrict mesher, VoxelCoords coords,
 								 ChunkCoords chunk_coords, VoxelFaces faces,
 								 const Rectangle* restrict uv_rect_lookup,
-								 block_t voxel)
+								 block_t voxel, uint8_t lod)
 {
 	const Rectangle* uv_rect = &uv_rect_lookup[voxel];
+	// size of one voxel at this level of detail, in world units
+	const voxel_index_signed_t step = (voxel_index_signed_t)(1 << lod);
+	const float scale = (float)step;
 	const Vector3 rl_coords = (Vector3){
-		(float)((voxel_index_signed_t)coords.x +
+		(float)(((voxel_index_signed_t)coords.x * step) +
 				(chunk_coords.x * max_voxelcoord.x)),
-		(float)coords.y,
-		(float)((voxel_index_signed_t)coords.z +
+		(float)(coords.y * step),
+		(float)(((voxel_index_signed_t)coords.z * step) +
 				(chunk_coords.z * max_voxelcoord.z)),
 	};
 
 	// z-
 	if (faces.north) {
+		mesher_set_region(mesher, NORTH);
 		const VoxelFaceInfo north_face = {
 			.normal = {0, 0, -1},
 			.vertex_infos = {
@@ -282,11 +340,12 @@ void terrain_add_voxel_to_mesher(Mesher* restrict mesher, VoxelCoords coords,
 				{.offset = {0, 1, 0}, .uv = {uv_rect->x, uv_rect->height}},
 				{.offset = {1, 1, 0}, .uv = {uv_rect->width, uv_rect->y}},
 			}};
-		terrain_mesher_add_face(mesher, &rl_coords, &north_face);
+		terrain_mesher_add_face(mesher, &rl_coords, &north_face, scale);
 	}
 
 	// z+
 	if (faces.south) {
+		mesher_set_region(mesher, SOUTH);
 		const VoxelFaceInfo south_face = {
 			.normal = {0, 0, 1},
 			.vertex_infos = {
@@ -297,11 +356,12 @@ void terrain_add_voxel_to_mesher(Mesher* restrict mesher, VoxelCoords coords,
 				{.offset = {1, 1, 1}, .uv = {uv_rect->width, uv_rect->height}},
 				{.offset = {0, 1, 1}, .uv = {uv_rect->x, uv_rect->height}},
 			}};
-		terrain_mesher_add_face(mesher, &rl_coords, &south_face);
+		terrain_mesher_add_face(mesher, &rl_coords, &south_face, scale);
 	}
 
 	// x+
 	if (faces.west) {
+		mesher_set_region(mesher, WEST);
 		const VoxelFaceInfo west_face = {
 			.normal = {1, 0, 0},
 			.vertex_infos = {
@@ -312,11 +372,12 @@ void terrain_add_voxel_to_mesher(Mesher* restrict mesher, VoxelCoords coords,
 				{.offset = {1, 1, 0}, .uv = {uv_rect->width, uv_rect->y}},
 				{.offset = {1, 1, 1}, .uv = {uv_rect->width, uv_rect->height}},
 			}};
-		terrain_mesher_add_face(mesher, &rl_coords, &west_face);
+		terrain_mesher_add_face(mesher, &rl_coords, &west_face, scale);
 	}
 
 	// x-
 	if (faces.east) {
+		mesher_set_region(mesher, EAST);
 		const VoxelFaceInfo east_face = {
 			.normal = {-1, 0, 0},
 			.vertex_infos = {
@@ -327,10 +388,11 @@ void terrain_add_voxel_to_mesher(Mesher* restrict mesher, VoxelCoords coords,
 				{.offset = {0, 1, 1}, .uv = {uv_rect->width, uv_rect->height}},
 				{.offset = {0, 1, 0}, .uv = {uv_rect->width, uv_rect->y}},
 			}};
-		terrain_mesher_add_face(mesher, &rl_coords, &east_face);
+		terrain_mesher_add_face(mesher, &rl_coords, &east_face, scale);
 	}
 
 	if (faces.up) {
+		mesher_set_region(mesher, UP);
 		const VoxelFaceInfo east_face = {
 			.normal = {0, 1, 0},
 			.vertex_infos = {
@@ -341,10 +403,11 @@ void terrain_add_voxel_to_mesher(Mesher* restrict mesher, VoxelCoords coords,
 				{.offset = {0, 1, 1}, .uv = {uv_rect->x, uv_rect->height}},
 				{.offset = {1, 1, 1}, .uv = {uv_rect->width, uv_rect->height}},
 			}};
-		terrain_mesher_add_face(mesher, &rl_coords, &east_face);
+		terrain_mesher_add_face(mesher, &rl_coords, &east_face, scale);
 	}
 
 	if (faces.down) {
+		mesher_set_region(mesher, DOWN);
 		const VoxelFaceInfo east_face = {
 			.normal = {0, -1, 0},
 			.vertex_infos = {
@@ -355,7 +418,7 @@ void terrain_add_voxel_to_mesher(Mesher* restrict mesher, VoxelCoords coords,
 				{.offset = {1, 0, 1}, .uv = {uv_rect->width, uv_rect->height}},
 				{.offset = {0, 0, 1}, .uv = {uv_rect->x, uv_rect->height}},
 			}};
-		terrain_mesher_add_face(mesher, &rl_coords, &east_face);
+		terrain_mesher_add_face(mesher, &rl_coords, &east_face, scale);
 	}
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 #include "constants/general.h"
 #include "mesher.h"
+#include "terrain_render.h"
 #include <assert.h>
 #include <raylib.h>
 #include <stdint.h>
@@ -19,6 +20,32 @@ static_assert(
 /// Height of chunks, in voxels.
 #define WORLD_HEIGHT 256
 
+/// Number of levels of detail. A level n chunk is built from voxels 2^n times
+/// as large on each axis as a full detail chunk, so it has 8^n times fewer.
+#define TERRAIN_LOD_COUNT 3
+/// Chunks fewer than this many chunks away from every plane are built at full
+/// detail.
+#ifndef TERRAIN_LOD_RADIUS
+#define TERRAIN_LOD_RADIUS 2
+#endif
+/// Width, in chunks, of the ring of each intermediate level of detail past
+/// TERRAIN_LOD_RADIUS. Anything further is built at the lowest detail.
+#ifndef TERRAIN_LOD_BAND
+#define TERRAIN_LOD_BAND 1
+#endif
+/// Light terrain faces from a table of the six directions they can face, worked
+/// out once at load, instead of running every light for every fragment. Drops
+/// the specular highlights.
+#ifndef TERRAIN_BAKED_LIGHTING
+#define TERRAIN_BAKED_LIGHTING 1
+#endif
+/// How far down, in full detail voxels, the outward faces along a chunk's
+/// border are forced to extend below the surface. Hides the cracks between
+/// neighboring chunks of different levels of detail.
+#define TERRAIN_LOD_SKIRT_DEPTH 4
+static_assert((CHUNK_SIZE >> (TERRAIN_LOD_COUNT - 1)) > 0,
+			  "Lowest level of detail has chunks with no voxels");
+
 /// The number type for basic block info needed for rendering.
 /// 0 = empty.
 typedef uint8_t block_t;
@@ -38,12 +65,35 @@ typedef struct
 	chunk_index_t z;
 } ChunkCoords;
 
+enum Sides : uint8_t
+{
+	SOUTH = 0,
+	NORTH,
+	WEST,
+	EAST,
+	UP,
+	DOWN,
+	NUM_SIDES
+};
+
 typedef struct
 {
 	/// Number of players who have this chunk in their render distance
 	uint8_t loaders;
+	/// Level of detail this chunk's mesh was built at, 0 is full detail
+	uint8_t lod;
 	ChunkCoords position;
-	Mesh mesh;
+	/// world-space box around the chunk's mesh, for culling. min > max if the
+	/// chunk has no faces
+	BoundingBox bounds;
+	/// world-space box which is entirely solid terrain, for occlusion culling.
+	/// flat (max.y == min.y) if some column of the chunk is open to the bottom
+	BoundingBox occluder;
+	/// the chunk's vertices in the shared terrain buffer
+	TerrainMeshRange range;
+	/// number of vertices facing each side (enum Sides). the range holds every
+	/// side's vertices back to back, in that order
+	uint32_t side_vertices[NUM_SIDES];
 } Chunk;
 
 typedef struct
@@ -54,8 +104,7 @@ typedef struct
 } AvailableIndicesStack;
 
 /// In-memory mesh data for all terrain surrounding every player.
-/// Involves a lot of pointer indirection. Each mesh's vertices, indices, and
-/// texcoords are allocated on separate buffers.
+/// Chunk vertices all live in one shared GPU buffer, see terrain_render.h.
 /// Always allocated to full capacity at game load time. "capacty" is only
 /// runtime because we may want to changet he number of players per game in the
 /// future?
@@ -104,17 +153,6 @@ typedef struct
 	Vector3 normal;
 } VoxelFaceInfo;
 
-enum Sides : uint8_t
-{
-	SOUTH = 0,
-	NORTH,
-	WEST,
-	EAST,
-	UP,
-	DOWN,
-	NUM_SIDES
-};
-
 /// Typedef used to record a single bit per face of a voxel. Useful for storing
 /// information about what sides of a voxel are visible.
 typedef struct
@@ -133,16 +171,28 @@ typedef struct
 	size_t indices[RENDER_DISTANCE * RENDER_DISTANCE * NUM_PLANES];
 } UnneededChunkList;
 
-// get the block_t for a single voxel given its coordinates
-block_t terrain_generate_voxel(ChunkCoords chunk, VoxelCoords voxel);
+// get the block_t for a single voxel given its coordinates. at levels of detail
+// above 0, voxel coordinates are in units of the larger voxels
+block_t terrain_generate_voxel(ChunkCoords chunk, VoxelCoords voxel,
+							   uint8_t lod);
+/// Height of the terrain surface at a world position, from only the 2D height
+/// layers. The 3D density noise carves caves and overhangs around this, but on
+/// average the voxel surface sits here.
+float terrain_sample_surface_height(float x, float z, uint8_t lod);
+/// Adds the voxel's visible faces to the mesher. The mesher must have one
+/// region per side, faces go into the region of the side they face.
 void terrain_add_voxel_to_mesher(Mesher* restrict mesher, VoxelCoords coords,
 								 ChunkCoords chunk_coords, VoxelFaces faces,
 								 const Rectangle* restrict uv_rect_lookup,
-								 block_t voxel);
+								 block_t voxel, uint8_t lod);
 
+/// Add one face to the mesher. Face vertex offsets are multiplied by scale.
 void terrain_mesher_add_face(Mesher* restrict mesher,
 							 const Vector3* restrict position,
-							 const VoxelFaceInfo* restrict face);
+							 const VoxelFaceInfo* restrict face, float scale);
+
+/// Number of voxels along each axis of a chunk at the given level of detail.
+VoxelCoords terrain_lod_dimensions(uint8_t lod);
 
 /// Inserts a new chunk into the terrain data
 /// returns the index at which the item was inserted
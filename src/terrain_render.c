@@ -1,143 +1,474 @@
 #include "terrain_render.h"
+#include "gl_state.h"
 #include "threadutils.h"
 #include <assert.h>
 #include <external/glad.h>
+#include <raymath.h>
 #include <rlgl.h>
 #include <stdlib.h>
 
-#define MAX_MESH_VERTEX_BUFFERS 7 // Maximum vertex buffers (VBO) per mesh
+/// Vertices the shared buffer starts out with room for. It doubles whenever it
+/// runs out.
+#define TERRAIN_BUFFER_INITIAL_VERTICES (1 << 20)
 
-void replaceVertexBuffer(const void* buffer, int size, bool dynamic,
-						 unsigned int id)
+/// Ranges are handed out in power of two size classes, starting at this many
+/// vertices, so that a freed chunk's range fits most new chunks exactly.
+#define TERRAIN_SIZE_CLASS_MIN_VERTICES 256
+#define TERRAIN_SIZE_CLASSES 16
+
+// bytes per vertex in each of the buffer's regions
+#define POSITION_STRIDE (3 * sizeof(float))
+#define TEXCOORD_STRIDE (2 * sizeof(float))
+#define NORMAL_STRIDE (3 * sizeof(float))
+
+/// Layout expected by glMultiDrawArraysIndirect
+typedef struct
 {
-#if defined(GRAPHICS_API_OPENGL_33) || defined(GRAPHICS_API_OPENGL_ES2)
-	glBindBuffer(GL_ARRAY_BUFFER, id);
-	glBufferData(GL_ARRAY_BUFFER, size, buffer,
-				 dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
-#endif
-}
+	GLuint count;
+	GLuint instance_count;
+	GLuint first;
+	GLuint base_instance;
+} DrawArraysIndirectCommand;
+
+/// All terrain vertices live in one GL buffer, split into a region for each
+/// attribute. Each region has room for capacity vertices, so a vertex's
+/// attributes are all at the same index in their regions and one VAO can
+/// draw any chunk.
+typedef struct
+{
+	unsigned int vao;
+	unsigned int vbo;
+	uint32_t capacity;
+	/// never used ranges of the buffer, sorted by first and never touching.
+	/// only counts are meaningful, capacity is ignored
+	TerrainMeshRange* free_ranges;
+	size_t free_count;
+	size_t free_capacity;
+	/// stacks of freed ranges for each size class, each recycled_capacity long
+	TerrainMeshRange* recycled[TERRAIN_SIZE_CLASSES];
+	size_t recycled_count[TERRAIN_SIZE_CLASSES];
+	size_t recycled_capacity;
+	/// ranges currently handed out
+	size_t live_count;
+	TerrainBufferStats stats;
+} TerrainBuffer;
+
+/// Per-draw scratch, sized for every mesh being drawn at once
+typedef struct
+{
+	size_t capacity;
+	unsigned int indirect_buffer;
+	DrawArraysIndirectCommand* commands;
+	GLint* firsts;
+	GLsizei* counts;
+} TerrainDrawBatch;
+
+static TerrainBuffer terrain_buffer;
+static TerrainDrawBatch draw_batch;
+static bool use_indirect;
+
+static void terrain_buffer_setup_attributes();
+static void terrain_buffer_grow(uint32_t min_capacity);
+static bool terrain_buffer_alloc(uint32_t count, TerrainMeshRange* out);
+static void terrain_buffer_release(TerrainMeshRange range);
+static uint8_t terrain_size_class(uint32_t count);
+static uint32_t terrain_size_class_capacity(uint8_t size_class);
 
-void terrain_render_clear_mesh(Mesh* mesh)
+void terrain_render_init(size_t max_meshes, size_t max_draws)
 {
-	assert(mesh->vboId);
-	for (uint8_t i = 0; i < MAX_MESH_VERTEX_BUFFERS; ++i) {
-		mesh->vboId[i] = 0;
+	// every allocation can split at most one free range in two
+	terrain_buffer.free_capacity = max_meshes + 2;
+	terrain_buffer.free_ranges =
+		RL_MALLOC(terrain_buffer.free_capacity * sizeof(TerrainMeshRange));
+	CHECKMEM(terrain_buffer.free_ranges);
+	terrain_buffer.capacity = TERRAIN_BUFFER_INITIAL_VERTICES;
+	terrain_buffer.free_ranges[0] = (TerrainMeshRange){
+		.first = 0,
+		.count = TERRAIN_BUFFER_INITIAL_VERTICES,
+	};
+	terrain_buffer.free_count = 1;
+	// each size class can have at most every live mesh, plus the one being
+	// uploaded, freed into it
+	terrain_buffer.recycled_capacity = max_meshes + 1;
+	for (uint8_t i = 0; i < TERRAIN_SIZE_CLASSES; ++i) {
+		terrain_buffer.recycled[i] = RL_MALLOC(
+			terrain_buffer.recycled_capacity * sizeof(TerrainMeshRange));
+		CHECKMEM(terrain_buffer.recycled[i]);
 	}
-	mesh->vaoId = 0;
+
+	glGenVertexArrays(1, &terrain_buffer.vao);
+	glGenBuffers(1, &terrain_buffer.vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, terrain_buffer.vbo);
+	glBufferData(GL_ARRAY_BUFFER,
+				 (GLsizeiptr)terrain_buffer.capacity *
+					 (POSITION_STRIDE + TEXCOORD_STRIDE + NORMAL_STRIDE),
+				 NULL, GL_STATIC_DRAW);
+	++terrain_buffer.stats.driver_allocations;
+	terrain_buffer_setup_attributes();
+
+	draw_batch.capacity = max_draws;
+	draw_batch.commands =
+		RL_MALLOC(max_draws * sizeof(DrawArraysIndirectCommand));
+	draw_batch.firsts = RL_MALLOC(max_draws * sizeof(GLint));
+	draw_batch.counts = RL_MALLOC(max_draws * sizeof(GLsizei));
+	CHECKMEM(draw_batch.commands);
+	CHECKMEM(draw_batch.firsts);
+	CHECKMEM(draw_batch.counts);
+
+	use_indirect = GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_multi_draw_indirect;
+	if (use_indirect) {
+		glGenBuffers(1, &draw_batch.indirect_buffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, draw_batch.indirect_buffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER,
+					 (GLsizeiptr)(max_draws *
+								  sizeof(DrawArraysIndirectCommand)),
+					 NULL, GL_STREAM_DRAW);
+		++terrain_buffer.stats.driver_allocations;
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	TraceLog(LOG_INFO, "terrain: drawing chunks with %s",
+			 use_indirect ? "glMultiDrawArraysIndirect" : "glMultiDrawArrays");
 }
 
-// Upload vertex data into a VAO (if supported) and VBO
-void UploadTerrainMesh(Mesh* mesh, const Mesh* existing_mesh, bool dynamic)
+void terrain_render_cleanup()
 {
-	if (mesh->vaoId > 0) {
-		// Check if mesh has already been loaded in GPU
-		TRACELOG(LOG_WARNING,
-				 "VAO: [ID %i] Trying to re-load an already loaded mesh",
-				 mesh->vaoId);
-		return;
+	if (terrain_buffer.live_count != 0) {
+		TraceLog(LOG_WARNING, "%zu terrain meshes were never freed",
+				 terrain_buffer.live_count);
 	}
+	glDeleteVertexArrays(1, &terrain_buffer.vao);
+	glDeleteBuffers(1, &terrain_buffer.vbo);
+	RL_FREE(terrain_buffer.free_ranges);
+	for (uint8_t i = 0; i < TERRAIN_SIZE_CLASSES; ++i) {
+		RL_FREE(terrain_buffer.recycled[i]);
+	}
+	terrain_buffer = (TerrainBuffer){0};
 
-	mesh->vboId =
-		(unsigned int*)RL_CALLOC(MAX_MESH_VERTEX_BUFFERS, sizeof(unsigned int));
-	mesh->vaoId = 0; // Vertex Array Object
+	if (draw_batch.indirect_buffer != 0) {
+		glDeleteBuffers(1, &draw_batch.indirect_buffer);
+	}
+	RL_FREE(draw_batch.commands);
+	RL_FREE(draw_batch.firsts);
+	RL_FREE(draw_batch.counts);
+	draw_batch = (TerrainDrawBatch){0};
+}
 
-#if defined(GRAPHICS_API_OPENGL_33) || defined(GRAPHICS_API_OPENGL_ES2)
-	mesh->vaoId = existing_mesh ? existing_mesh->vaoId : rlLoadVertexArray();
-	rlEnableVertexArray(mesh->vaoId);
+TerrainMeshRange terrain_render_upload(const Mesh* mesh,
+									   const StagingRange* staged)
+{
+	assert(mesh->vertices != NULL);
+	assert(mesh->texcoords != NULL);
+	assert(mesh->normals != NULL);
+	assert(mesh->vertexCount >= 0);
 
-	// NOTE: Vertex attributes must be uploaded considering default locations
-	// points and available vertex data
+	TerrainMeshRange range = {0};
+	const uint32_t count = (uint32_t)mesh->vertexCount;
+	if (count == 0) {
+		return range;
+	}
 
-	assert(mesh->normals != NULL);
-	assert(mesh->colors == NULL);
-	assert(mesh->tangents == NULL);
-	assert(mesh->texcoords2 == NULL);
-	assert(mesh->animVertices == NULL);
-
-	// Enable vertex attributes: position (shader-location = 0)
-	if (!existing_mesh) {
-		mesh->vboId[0] = rlLoadVertexBuffer(
-			mesh->vertices, mesh->vertexCount * 3 * sizeof(float), dynamic);
+	const uint8_t size_class = terrain_size_class(count);
+	if (terrain_buffer.recycled_count[size_class] > 0) {
+		// same size class as some freed mesh, overwrite it in place
+		--terrain_buffer.recycled_count[size_class];
+		range = terrain_buffer.recycled[size_class]
+									   [terrain_buffer.recycled_count[size_class]];
+		++terrain_buffer.stats.recycled;
 	} else {
-		assert(existing_mesh->vboId[0] != 0);
-		replaceVertexBuffer(mesh->vertices,
-							mesh->vertexCount * 3 * sizeof(float), dynamic,
-							existing_mesh->vboId[0]);
-		mesh->vboId[0] = existing_mesh->vboId[0];
-	}
-	rlSetVertexAttribute(0, 3, RL_FLOAT, 0, 0, 0);
-	rlEnableVertexAttribute(0);
-
-	// Enable vertex attributes: texcoords (shader-location = 1)
-	if (!existing_mesh) {
-		mesh->vboId[1] = rlLoadVertexBuffer(
-			mesh->texcoords, mesh->vertexCount * 2 * sizeof(float), dynamic);
+		const uint32_t capacity = terrain_size_class_capacity(size_class);
+		if (!terrain_buffer_alloc(capacity, &range)) {
+			terrain_buffer_grow(terrain_buffer.capacity + capacity);
+			const bool allocated = terrain_buffer_alloc(capacity, &range);
+			assert(allocated);
+			(void)allocated;
+		}
+		++terrain_buffer.stats.carved;
+	}
+	assert(range.capacity >= count);
+	range.count = count;
+	++terrain_buffer.live_count;
+
+	const size_t capacity = terrain_buffer.capacity;
+	if (staged->data != NULL) {
+		assert(staged->data == mesh->vertices);
+		const size_t position_bytes = count * POSITION_STRIDE;
+		const size_t texcoord_bytes = count * TEXCOORD_STRIDE;
+		staging_copy(staged, 0, position_bytes, terrain_buffer.vbo,
+					 range.first * POSITION_STRIDE);
+		staging_copy(staged, position_bytes, texcoord_bytes,
+					 terrain_buffer.vbo,
+					 (capacity * POSITION_STRIDE) +
+						 (range.first * TEXCOORD_STRIDE));
+		staging_copy(staged, position_bytes + texcoord_bytes,
+					 count * NORMAL_STRIDE, terrain_buffer.vbo,
+					 (capacity * (POSITION_STRIDE + TEXCOORD_STRIDE)) +
+						 (range.first * NORMAL_STRIDE));
+		return range;
+	}
+
+	// the staging ring was full, send this one the slow way and start on a
+	// fresh segment for the next
+	staging_fence();
+	glBindBuffer(GL_ARRAY_BUFFER, terrain_buffer.vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(range.first * POSITION_STRIDE),
+					(GLsizeiptr)(count * POSITION_STRIDE), mesh->vertices);
+	glBufferSubData(GL_ARRAY_BUFFER,
+					(GLintptr)((capacity * POSITION_STRIDE) +
+							   (range.first * TEXCOORD_STRIDE)),
+					(GLsizeiptr)(count * TEXCOORD_STRIDE), mesh->texcoords);
+	glBufferSubData(
+		GL_ARRAY_BUFFER,
+		(GLintptr)((capacity * (POSITION_STRIDE + TEXCOORD_STRIDE)) +
+				   (range.first * NORMAL_STRIDE)),
+		(GLsizeiptr)(count * NORMAL_STRIDE), mesh->normals);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return range;
+}
+
+void terrain_render_free(TerrainMeshRange* range)
+{
+	if (range->capacity > 0) {
+		const uint8_t size_class = terrain_size_class(range->capacity);
+		assert(terrain_size_class_capacity(size_class) == range->capacity);
+		assert(terrain_buffer.recycled_count[size_class] <
+			   terrain_buffer.recycled_capacity);
+		terrain_buffer
+			.recycled[size_class][terrain_buffer.recycled_count[size_class]] =
+			*range;
+		++terrain_buffer.recycled_count[size_class];
+		assert(terrain_buffer.live_count > 0);
+		--terrain_buffer.live_count;
+	}
+	*range = (TerrainMeshRange){0};
+}
+
+TerrainBufferStats terrain_render_get_buffer_stats()
+{
+	return terrain_buffer.stats;
+}
+
+unsigned int terrain_render_get_vao() { return terrain_buffer.vao; }
+
+void terrain_render_draw(const Material* material, uint8_t view_count,
+						 const TerrainMeshRange* ranges, size_t count)
+{
+	assert(count <= draw_batch.capacity);
+	if (count == 0) {
+		return;
+	}
+
+	// the same uniforms DrawMesh would set, once for every chunk. gl_state
+	// skips the ones which haven't changed since last time
+	const Shader shader = material->shader;
+	gl_state_use_program(shader.id);
+	const Color color = material->maps[MATERIAL_MAP_DIFFUSE].color;
+	gl_state_set_uniform(shader.locs[SHADER_LOC_COLOR_DIFFUSE],
+						 (float[4]){
+							 (float)color.r / 255.0f,
+							 (float)color.g / 255.0f,
+							 (float)color.b / 255.0f,
+							 (float)color.a / 255.0f,
+						 },
+						 SHADER_UNIFORM_VEC4, 1);
+	const Matrix model = rlGetMatrixTransform();
+	gl_state_set_uniform_matrix(shader.locs[SHADER_LOC_MATRIX_VIEW],
+								rlGetMatrixModelview());
+	gl_state_set_uniform_matrix(shader.locs[SHADER_LOC_MATRIX_PROJECTION],
+								rlGetMatrixProjection());
+	gl_state_set_uniform_matrix(shader.locs[SHADER_LOC_MATRIX_MODEL], model);
+	if (shader.locs[SHADER_LOC_MATRIX_NORMAL] != -1) {
+		gl_state_set_uniform_matrix(shader.locs[SHADER_LOC_MATRIX_NORMAL],
+									MatrixTranspose(MatrixInvert(model)));
+	}
+
+	const int diffuse_slot = 0;
+	gl_state_bind_texture(diffuse_slot, GL_TEXTURE_2D,
+						  material->maps[MATERIAL_MAP_DIFFUSE].texture.id);
+	gl_state_set_uniform(shader.locs[SHADER_LOC_MAP_DIFFUSE], &diffuse_slot,
+						 SHADER_UNIFORM_INT, 1);
+
+	gl_state_bind_vertex_array(terrain_buffer.vao);
+	if (use_indirect) {
+		for (size_t i = 0; i < count; ++i) {
+			draw_batch.commands[i] = (DrawArraysIndirectCommand){
+				.count = ranges[i].count,
+				.instance_count = view_count,
+				.first = ranges[i].first,
+				.base_instance = 0,
+			};
+		}
+		gl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER,
+							 draw_batch.indirect_buffer);
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0,
+						(GLsizeiptr)(count * sizeof(DrawArraysIndirectCommand)),
+						draw_batch.commands);
+		glMultiDrawArraysIndirect(GL_TRIANGLES, NULL, (GLsizei)count, 0);
+	} else if (view_count == 1) {
+		for (size_t i = 0; i < count; ++i) {
+			draw_batch.firsts[i] = (GLint)ranges[i].first;
+			draw_batch.counts[i] = (GLsizei)ranges[i].count;
+		}
+		glMultiDrawArrays(GL_TRIANGLES, draw_batch.firsts, draw_batch.counts,
+						  (GLsizei)count);
 	} else {
-		assert(existing_mesh->vboId[1] != 0);
-		replaceVertexBuffer(mesh->texcoords,
-							mesh->vertexCount * 2 * sizeof(float), dynamic,
-							existing_mesh->vboId[1]);
-		mesh->vboId[1] = existing_mesh->vboId[1];
-	}
-	rlSetVertexAttribute(1, 2, RL_FLOAT, 0, 0, 0);
-	rlEnableVertexAttribute(1);
-
-	// WARNING: When setting default vertex attribute values, the values for
-	// each generic vertex attribute is part of current state, and it is
-	// maintained even if a different program object is used
-
-	{
-		// Enable vertex attributes: normals (shader-location = 2)
-		void* normals =
-			mesh->animNormals != NULL ? mesh->animNormals : mesh->normals;
-		if (!existing_mesh) {
-			mesh->vboId[2] = rlLoadVertexBuffer(
-				normals, mesh->vertexCount * 3 * sizeof(float), dynamic);
-		} else {
-			assert(existing_mesh->vboId[2] != 0);
-			replaceVertexBuffer(normals, mesh->vertexCount * 3 * sizeof(float),
-								dynamic, existing_mesh->vboId[2]);
-			mesh->vboId[2] = existing_mesh->vboId[2];
+		// there is no instanced glMultiDrawArrays without indirect drawing
+		for (size_t i = 0; i < count; ++i) {
+			glDrawArraysInstanced(GL_TRIANGLES, (GLint)ranges[i].first,
+								  (GLsizei)ranges[i].count, view_count);
 		}
-		rlSetVertexAttribute(2, 3, RL_FLOAT, 0, 0, 0);
-		rlEnableVertexAttribute(2);
 	}
+}
+
+/// Point the VAO's attributes at each region of the vertex buffer. Needs
+/// redoing whenever the buffer is replaced.
+static void terrain_buffer_setup_attributes()
+{
+	const size_t capacity = terrain_buffer.capacity;
+	glBindVertexArray(terrain_buffer.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, terrain_buffer.vbo);
+
+	// same locations raylib binds its default attributes to
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0,
+						  (void*)(capacity * POSITION_STRIDE));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(
+		2, 3, GL_FLOAT, GL_FALSE, 0,
+		(void*)(capacity * (POSITION_STRIDE + TEXCOORD_STRIDE)));
+	glEnableVertexAttribArray(2);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/// Replace the vertex buffer with a bigger one, keeping everything which is
+/// already in it at the same vertex index.
+static void terrain_buffer_grow(uint32_t min_capacity)
+{
+	const uint32_t old_capacity = terrain_buffer.capacity;
+	uint32_t new_capacity = old_capacity * 2;
+	while (new_capacity < min_capacity) {
+		new_capacity *= 2;
+	}
+	TraceLog(LOG_INFO, "terrain: growing vertex buffer to %u vertices",
+			 new_capacity);
+
+	unsigned int new_vbo = 0;
+	glGenBuffers(1, &new_vbo);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, new_vbo);
+	glBufferData(GL_COPY_WRITE_BUFFER,
+				 (GLsizeiptr)new_capacity *
+					 (POSITION_STRIDE + TEXCOORD_STRIDE + NORMAL_STRIDE),
+				 NULL, GL_STATIC_DRAW);
+	++terrain_buffer.stats.driver_allocations;
+	glBindBuffer(GL_COPY_READ_BUFFER, terrain_buffer.vbo);
 
-	{
-		// Default vertex attribute: color
-		// WARNING: Default value provided to shader if location available
-		float value[4] = {1.0f, 1.0f, 1.0f, 1.0f}; // WHITE
-		rlSetVertexAttributeDefault(3, value, SHADER_ATTRIB_VEC4, 4);
-		rlDisableVertexAttribute(3);
+	const size_t strides[] = {POSITION_STRIDE, TEXCOORD_STRIDE, NORMAL_STRIDE};
+	size_t old_offset = 0;
+	size_t new_offset = 0;
+	for (uint8_t i = 0; i < sizeof(strides) / sizeof(strides[0]); ++i) {
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+							(GLintptr)old_offset, (GLintptr)new_offset,
+							(GLsizeiptr)(old_capacity * strides[i]));
+		old_offset += old_capacity * strides[i];
+		new_offset += new_capacity * strides[i];
 	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glDeleteBuffers(1, &terrain_buffer.vbo);
 
-	{
-		// Default vertex attribute: tangent
-		// WARNING: Default value provided to shader if location available
-		float value[4] = {0.0f, 0.0f, 0.0f, 0.0f};
-		rlSetVertexAttributeDefault(4, value, SHADER_ATTRIB_VEC4, 4);
-		rlDisableVertexAttribute(4);
+	terrain_buffer.vbo = new_vbo;
+	terrain_buffer.capacity = new_capacity;
+	terrain_buffer_release((TerrainMeshRange){
+		.first = old_capacity,
+		.count = new_capacity - old_capacity,
+	});
+	terrain_buffer_setup_attributes();
+}
+
+/// First fit. Returns false if no free range is large enough.
+static bool terrain_buffer_alloc(uint32_t count, TerrainMeshRange* out)
+{
+	for (size_t i = 0; i < terrain_buffer.free_count; ++i) {
+		TerrainMeshRange* free_range = &terrain_buffer.free_ranges[i];
+		if (free_range->count < count) {
+			continue;
+		}
+		*out = (TerrainMeshRange){
+			.first = free_range->first,
+			.count = count,
+			.capacity = count,
+		};
+		free_range->first += count;
+		free_range->count -= count;
+		if (free_range->count == 0) {
+			// remove it, keeping the list sorted
+			for (size_t j = i + 1; j < terrain_buffer.free_count; ++j) {
+				terrain_buffer.free_ranges[j - 1] =
+					terrain_buffer.free_ranges[j];
+			}
+			--terrain_buffer.free_count;
+		}
+		return true;
 	}
+	return false;
+}
 
-	{
-		// Default vertex attribute: texcoord2
-		// WARNING: Default value provided to shader if location available
-		float value[2] = {0.0f, 0.0f};
-		rlSetVertexAttributeDefault(5, value, SHADER_ATTRIB_VEC2, 2);
-		rlDisableVertexAttribute(5);
+/// Add a never used range into the free list, merging it with its neighbors.
+static void terrain_buffer_release(TerrainMeshRange range)
+{
+	TerrainMeshRange* ranges = terrain_buffer.free_ranges;
+	// index of the first free range after this one
+	size_t index = 0;
+	while (index < terrain_buffer.free_count &&
+		   ranges[index].first < range.first) {
+		++index;
 	}
 
-	if (mesh->indices != NULL) {
-		mesh->vboId[6] = rlLoadVertexBufferElement(
-			mesh->indices, mesh->triangleCount * 3 * sizeof(unsigned short),
-			dynamic);
+	const bool merge_before =
+		index > 0 &&
+		ranges[index - 1].first + ranges[index - 1].count == range.first;
+	const bool merge_after = index < terrain_buffer.free_count &&
+							 range.first + range.count == ranges[index].first;
+
+	if (merge_before && merge_after) {
+		ranges[index - 1].count += range.count + ranges[index].count;
+		for (size_t j = index + 1; j < terrain_buffer.free_count; ++j) {
+			ranges[j - 1] = ranges[j];
+		}
+		--terrain_buffer.free_count;
+	} else if (merge_before) {
+		ranges[index - 1].count += range.count;
+	} else if (merge_after) {
+		ranges[index].first = range.first;
+		ranges[index].count += range.count;
+	} else {
+		assert(terrain_buffer.free_count < terrain_buffer.free_capacity);
+		for (size_t j = terrain_buffer.free_count; j > index; --j) {
+			ranges[j] = ranges[j - 1];
+		}
+		ranges[index] = range;
+		++terrain_buffer.free_count;
 	}
+}
 
-	if (mesh->vaoId <= 0) {
-		TRACELOG(LOG_ERROR, "Failed to upload mesh");
-		threadutils_exit(EXIT_FAILURE);
+static uint8_t terrain_size_class(uint32_t count)
+{
+	uint8_t size_class = 0;
+	while (terrain_size_class_capacity(size_class) < count) {
+		++size_class;
+		if (size_class >= TERRAIN_SIZE_CLASSES) {
+			TraceLog(LOG_FATAL, "terrain mesh with %u vertices is too large",
+					 count);
+			threadutils_exit(EXIT_FAILURE);
+		}
 	}
+	return size_class;
+}
 
-	rlDisableVertexArray();
-#endif
+static uint32_t terrain_size_class_capacity(uint8_t size_class)
+{
+	return (uint32_t)TERRAIN_SIZE_CLASS_MIN_VERTICES << size_class;
 }
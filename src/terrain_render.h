@@ -1,7 +1,62 @@
 #pragma once
+#include "staging.h"
 #include <raylib.h>
+#include <stddef.h>
+#include <stdint.h>
 
-void UploadTerrainMesh(Mesh* mesh, const Mesh* existing_mesh, bool dynamic);
+/// Where a chunk's vertices live in the shared terrain vertex buffer. Counted
+/// in vertices, the same range is used for positions, texcoords, and normals.
+typedef struct
+{
+	uint32_t first;
+	/// number of vertices drawn
+	uint32_t count;
+	/// number of vertices reserved, count rounded up to a size class
+	uint32_t capacity;
+} TerrainMeshRange;
 
-/// Set VAOs and VBOs to 0 so as to avoid unloading them upon UnloadMesh
-void terrain_render_clear_mesh(Mesh* mesh);
+/// Counters for how the shared buffer has been handing out space, since
+/// terrain_render_init.
+typedef struct
+{
+	/// times GPU storage was (re)allocated with glBufferData
+	size_t driver_allocations;
+	/// uploads which went into a range recycled from a freed mesh
+	size_t recycled;
+	/// uploads which needed a fresh range carved out of the buffer
+	size_t carved;
+} TerrainBufferStats;
+
+/// Create the shared terrain vertex buffer and its VAO. max_meshes is the
+/// largest number of terrain meshes which will be alive at once, max_draws is
+/// the largest number of ranges passed to terrain_render_draw.
+void terrain_render_init(size_t max_meshes, size_t max_draws);
+
+/// Free the shared vertex buffer. All terrain meshes must have been freed
+/// already.
+void terrain_render_cleanup();
+
+/// Copy a mesh's vertices, texcoords, and normals into the shared buffer. The
+/// mesh is drawn as unindexed triangles. Grows the buffer if it is full. If
+/// staged has data, the mesh's arrays are in it back to back (see
+/// mesher_use_staging) and are copied on the GPU, otherwise they are uploaded
+/// from the mesh.
+TerrainMeshRange terrain_render_upload(const Mesh* mesh,
+									   const StagingRange* staged);
+
+/// Give a mesh's space in the shared buffer back. Sets the range to empty.
+/// The space is kept for the next mesh of the same size class.
+void terrain_render_free(TerrainMeshRange* range);
+
+TerrainBufferStats terrain_render_get_buffer_stats();
+
+/// The vertex array every terrain mesh is drawn from.
+unsigned int terrain_render_get_vao();
+
+/// Draw a bunch of terrain meshes with the material's shader and diffuse
+/// texture, in a single draw call. The meshes are instanced once for each of
+/// the views last passed to scene_uniforms_set_views. Ranges are drawn in the
+/// order given. Binds through gl_state and leaves everything bound, so it must
+/// be drawn from the render queue.
+void terrain_render_draw(const Material* material, uint8_t view_count,
+						 const TerrainMeshRange* ranges, size_t count);
@@ -1,12 +1,6 @@
 #include "terrain_voxel_data.h"
 #include "threadutils.h"
 
-static const VoxelCoords max_voxelcoord = {
-	.x = CHUNK_SIZE,
-	.y = WORLD_HEIGHT,
-	.z = CHUNK_SIZE,
-};
-
 static const VoxelOffset all_offsets[NUM_SIDES] = {
 	(VoxelOffset){.axis = AXIS_Z, .negative = false},
 	(VoxelOffset){.axis = AXIS_Z, .negative = true},
@@ -23,9 +17,21 @@ static bool
 terrain_voxel_data_get_offset_is_solid(const IntermediateVoxelData* chunk_data,
 									   VoxelCoords coords, VoxelOffset offset);
 
+/// Figure out which faces of a solid voxel need to be in the mesh.
+static VoxelFaces
+terrain_voxel_data_get_faces(const IntermediateVoxelData* chunk_data,
+							 VoxelCoords coords);
+
+/// Whether a solid voxel on the border of a chunk is close enough to the
+/// surface that its outward faces should be forced on, to act as a skirt.
+static bool
+terrain_voxel_data_is_in_skirt(const IntermediateVoxelData* chunk_data,
+							   VoxelCoords coords);
+
 void terrain_voxel_data_populate_mesher(
 	const IntermediateVoxelData* restrict chunk_data, Mesher* restrict mesher)
 {
+	const VoxelCoords max_voxelcoord = terrain_lod_dimensions(chunk_data->lod);
 	VoxelCoords iter = {0};
 	for (iter.x = 0; iter.x < max_voxelcoord.x; ++iter.x) {
 		for (iter.y = 0; iter.y < max_voxelcoord.y; ++iter.y) {
@@ -34,33 +40,79 @@ void terrain_voxel_data_populate_mesher(
 					// empty
 					continue;
 				}
-				VoxelFaces faces = {
-					.south = !terrain_voxel_data_get_offset_is_solid(
-						chunk_data, iter, all_offsets[SOUTH]),
-					.north = !terrain_voxel_data_get_offset_is_solid(
-						chunk_data, iter, all_offsets[NORTH]),
-					.west = !terrain_voxel_data_get_offset_is_solid(
-						chunk_data, iter, all_offsets[WEST]),
-					.east = !terrain_voxel_data_get_offset_is_solid(
-						chunk_data, iter, all_offsets[EAST]),
-					.up = !terrain_voxel_data_get_offset_is_solid(
-						chunk_data, iter, all_offsets[UP]),
-					.down = !terrain_voxel_data_get_offset_is_solid(
-						chunk_data, iter, all_offsets[DOWN]),
-				};
+				VoxelFaces faces =
+					terrain_voxel_data_get_faces(chunk_data, iter);
 
 				block_t voxel = *terrain_voxel_data_get_const(chunk_data, iter);
 
 				terrain_add_voxel_to_mesher(mesher, iter, chunk_data->coords,
 											faces, chunk_data->uv_rect_lookup,
-											voxel);
+											voxel, chunk_data->lod);
 			}
 		}
 	}
 }
 
+static VoxelFaces
+terrain_voxel_data_get_faces(const IntermediateVoxelData* chunk_data,
+							 VoxelCoords coords)
+{
+	const bool skirt = terrain_voxel_data_is_in_skirt(chunk_data, coords);
+	const VoxelCoords max_voxelcoord = terrain_lod_dimensions(chunk_data->lod);
+	return (VoxelFaces){
+		.south = (skirt && coords.z == max_voxelcoord.z - 1) ||
+				 !terrain_voxel_data_get_offset_is_solid(chunk_data, coords,
+														 all_offsets[SOUTH]),
+		.north = (skirt && coords.z == 0) ||
+				 !terrain_voxel_data_get_offset_is_solid(chunk_data, coords,
+														 all_offsets[NORTH]),
+		.west = (skirt && coords.x == max_voxelcoord.x - 1) ||
+				!terrain_voxel_data_get_offset_is_solid(chunk_data, coords,
+														all_offsets[WEST]),
+		.east = (skirt && coords.x == 0) ||
+				!terrain_voxel_data_get_offset_is_solid(chunk_data, coords,
+														all_offsets[EAST]),
+		.up = !terrain_voxel_data_get_offset_is_solid(chunk_data, coords,
+													  all_offsets[UP]),
+		.down = !terrain_voxel_data_get_offset_is_solid(chunk_data, coords,
+														all_offsets[DOWN]),
+	};
+}
+
+static bool
+terrain_voxel_data_is_in_skirt(const IntermediateVoxelData* chunk_data,
+							   VoxelCoords coords)
+{
+	const VoxelCoords max_voxelcoord = terrain_lod_dimensions(chunk_data->lod);
+	if (coords.x != 0 && coords.z != 0 && coords.x != max_voxelcoord.x - 1 &&
+		coords.z != max_voxelcoord.z - 1) {
+		return false;
+	}
+
+	// neighbors may be at a different level of detail, so their surface may
+	// be a few voxels off from ours. hang a wall down from our surface so
+	// that there is never a gap to see through
+	uint16_t depth = TERRAIN_LOD_SKIRT_DEPTH >> chunk_data->lod;
+	if (depth == 0) {
+		depth = 1;
+	}
+	VoxelCoords above = coords;
+	for (uint16_t i = 0; i < depth; ++i) {
+		++above.y;
+		if (above.y >= max_voxelcoord.y) {
+			return true;
+		}
+		if (!terrain_voxel_is_solid(
+				*terrain_voxel_data_get_const(chunk_data, above))) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void terrain_voxel_data_generate(IntermediateVoxelData* voxels)
 {
+	const VoxelCoords max_voxelcoord = terrain_lod_dimensions(voxels->lod);
 	VoxelCoords iter = {0};
 	// TODO: this loop over voxels appears both here and in
 	// terrain_count_faces_in_chunk. This is code duplication and bad cache
@@ -73,34 +125,47 @@ void terrain_voxel_data_generate(IntermediateVoxelData* voxels)
 		for (iter.y = 0; iter.y < max_voxelcoord.y; ++iter.y) {
 			for (iter.z = 0; iter.z < max_voxelcoord.z; ++iter.z) {
 				*terrain_voxel_data_get(voxels, iter) =
-					terrain_generate_voxel(voxels->coords, iter);
+					terrain_generate_voxel(voxels->coords, iter, voxels->lod);
 			}
 		}
 	}
 }
 
+/// Index of a voxel in the voxels array, respecting level of detail
+static size_t terrain_voxel_data_index(const IntermediateVoxelData* voxels,
+									   VoxelCoords voxel)
+{
+	const VoxelCoords max_voxelcoord = terrain_lod_dimensions(voxels->lod);
+	assert(voxel.x < max_voxelcoord.x && voxel.y < max_voxelcoord.y &&
+		   voxel.z < max_voxelcoord.z);
+	return voxel.z + ((size_t)voxel.x * max_voxelcoord.z) +
+		   ((size_t)voxel.y * max_voxelcoord.x * max_voxelcoord.z);
+}
+
 block_t* terrain_voxel_data_get(IntermediateVoxelData* voxels,
 								VoxelCoords voxel)
 {
-	assert(voxel.z + voxel.x * max_voxelcoord.x + voxel.y * max_voxelcoord.y <
-		   CHUNK_SIZE * CHUNK_SIZE * WORLD_HEIGHT);
-	return &voxels->voxels[voxel.z + voxel.x * max_voxelcoord.x +
-						   voxel.y * max_voxelcoord.y];
+	const size_t val = terrain_voxel_data_index(voxels, voxel);
+	assert(val < CHUNK_SIZE * CHUNK_SIZE * WORLD_HEIGHT);
+	return &voxels->voxels[val];
 }
 
 const block_t* terrain_voxel_data_get_const(const IntermediateVoxelData* voxels,
 											VoxelCoords voxel)
 {
-	const size_t val =
-		voxel.z + voxel.x * max_voxelcoord.x + voxel.y * max_voxelcoord.y;
+	const size_t val = terrain_voxel_data_index(voxels, voxel);
 	static const size_t max = (long)CHUNK_SIZE * CHUNK_SIZE * WORLD_HEIGHT;
 	assert(val < max);
 	return &voxels->voxels[val];
 }
 
-size_t terrain_voxel_data_get_face_count(const IntermediateVoxelData* voxels)
+size_t terrain_voxel_data_get_face_counts(const IntermediateVoxelData* voxels,
+										  size_t counts[NUM_SIDES])
 {
-	size_t count = 0;
+	const VoxelCoords max_voxelcoord = terrain_lod_dimensions(voxels->lod);
+	for (uint8_t i = 0; i < NUM_SIDES; ++i) {
+		counts[i] = 0;
+	}
 	VoxelCoords iter = {0};
 	for (; iter.x < max_voxelcoord.x; ++iter.x) {
 		for (iter.y = 0; iter.y < max_voxelcoord.y; ++iter.y) {
@@ -113,26 +178,56 @@ size_t terrain_voxel_data_get_face_count(const IntermediateVoxelData* voxels)
 					continue;
 				}
 
-				// otherwise we need to count the number of solid neighbors
-				for (uint8_t i = 0; i < NUM_SIDES; ++i) {
-					// if the neighbor isn't solid, that means the  face is
-					// exposed and needs to be rendered
-					if (!terrain_voxel_data_get_offset_is_solid(
-							voxels, iter, all_offsets[i])) {
-						++count;
-					}
-				}
+				// otherwise we need to count the exposed faces. this has to
+				// agree exactly with what populate_mesher will add
+				const VoxelFaces faces =
+					terrain_voxel_data_get_faces(voxels, iter);
+				counts[SOUTH] += faces.south;
+				counts[NORTH] += faces.north;
+				counts[WEST] += faces.west;
+				counts[EAST] += faces.east;
+				counts[UP] += faces.up;
+				counts[DOWN] += faces.down;
 			}
 		}
 	}
 
+	size_t count = 0;
+	for (uint8_t i = 0; i < NUM_SIDES; ++i) {
+		count += counts[i];
+	}
 	return count;
 }
 
+voxel_index_t
+terrain_voxel_data_get_solid_height(const IntermediateVoxelData* voxels)
+{
+	const VoxelCoords max_voxelcoord = terrain_lod_dimensions(voxels->lod);
+	voxel_index_t solid_height = max_voxelcoord.y;
+	VoxelCoords iter = {0};
+	for (iter.x = 0; iter.x < max_voxelcoord.x; ++iter.x) {
+		for (iter.z = 0; iter.z < max_voxelcoord.z; ++iter.z) {
+			// no need to look higher than the lowest column so far
+			for (iter.y = 0; iter.y < solid_height; ++iter.y) {
+				if (!terrain_voxel_is_solid(
+						*terrain_voxel_data_get_const(voxels, iter))) {
+					break;
+				}
+			}
+			solid_height = iter.y;
+			if (solid_height == 0) {
+				return 0;
+			}
+		}
+	}
+	return (voxel_index_t)(solid_height << voxels->lod);
+}
+
 static bool
 terrain_voxel_data_get_offset_is_solid(const IntermediateVoxelData* chunk_data,
 									   VoxelCoords coords, VoxelOffset offset)
 {
+	const VoxelCoords max_voxelcoord = terrain_lod_dimensions(chunk_data->lod);
 	VoxelCoords offset_coords = coords;
 	ChunkCoords overflow_chunk = chunk_data->coords;
 
@@ -190,9 +285,10 @@ terrain_voxel_data_get_offset_is_solid(const IntermediateVoxelData* chunk_data,
 
 		// if we did overflow, we need to generate the value of the other
 		// chunk's blocks because we don't know it (this function only recieves
-		// the current chunk's data)
-		const block_t voxel =
-			terrain_generate_voxel(overflow_chunk, offset_coords);
+		// the current chunk's data). sampled at our own level of detail even
+		// if the neighbor is different, skirts take care of the mismatch
+		const block_t voxel = terrain_generate_voxel(
+			overflow_chunk, offset_coords, chunk_data->lod);
 		return terrain_voxel_is_solid(voxel);
 	}
 
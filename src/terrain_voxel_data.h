@@ -6,6 +6,9 @@
 typedef struct
 {
 	ChunkCoords coords;
+	/// Level of detail to generate at. Only the first
+	/// 1 / 8^lod of voxels is used when above 0.
+	uint8_t lod;
 	block_t voxels[CHUNK_SIZE * CHUNK_SIZE * WORLD_HEIGHT];
 	/// UV Rect for the texture of a given block_t, on a texture sampler stored
 	/// somewhere else
@@ -21,7 +24,14 @@ const block_t* terrain_voxel_data_get_const(const IntermediateVoxelData* voxels,
 // fill voxels with block_ts based on perlin noise values
 void terrain_voxel_data_generate(IntermediateVoxelData* voxels);
 
-size_t terrain_voxel_data_get_face_count(const IntermediateVoxelData* voxels);
+/// Count the faces populate_mesher will add, for each side (enum Sides).
+/// Returns the total.
+size_t terrain_voxel_data_get_face_counts(const IntermediateVoxelData* voxels,
+										  size_t counts[NUM_SIDES]);
+
+/// Height, in world units, below which every voxel of the chunk is solid.
+voxel_index_t
+terrain_voxel_data_get_solid_height(const IntermediateVoxelData* voxels);
 
 void terrain_voxel_data_populate_mesher(
 	const IntermediateVoxelData* restrict chunk_data, Mesher* restrict mesher);